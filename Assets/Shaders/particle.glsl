@@ -0,0 +1,37 @@
+#shader vertex
+#version 440 core
+
+
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec2 uv;
+layout(location = 2) in float instance_x;
+layout(location = 3) in float instance_y;
+
+out vec2 itpl_uv;
+
+uniform mat4 u_vp_mat;
+uniform float u_size;
+
+
+void main() {
+    itpl_uv = uv;
+    gl_Position = u_vp_mat * vec4(position.xy * u_size + vec2(instance_x, instance_y), 0, 1);
+}
+
+
+
+#shader fragment
+#version 440 core
+
+
+layout(location = 0) out vec4 color;
+in vec2 itpl_uv;
+
+uniform vec4 u_color;
+
+void main() {
+    vec2 d = itpl_uv - vec2(0.5);
+    if (dot(d, d) > 0.25)
+        discard;
+    color = u_color;
+}
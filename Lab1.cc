@@ -6,6 +6,16 @@
 #include "gpu_graphics/loadings.cc"
 #include "gpu_graphics/draw.cc"
 #include "physics.cc"
+#include "asset_bundle.cc"
+#include "scene.cc"
+#include "render.cc"
+#include "prefabs.cc"
+#include "scene_import.cc"
+#include "particles.cc"
+#include "perf_counters.cc"
+#include "determinism.cc"
+#include "world_streaming.cc"
+#include "step_budget.cc"
 
 #include "cp_lib/basic.cc"
 #include "cp_lib/array.cc"
@@ -16,56 +26,57 @@
 
 using namespace cp;
 
-struct {
-    bool is_physics_updated = true;
-    bool are_colliders_rendered = true;
-    vec4f clear_color = {0, 0.2, 0.2, 1};
-} Sandbox_Settings;
-
-sbuff<vec3f, 4> quad_vrt_positions = {{
-    { -0.5f, -0.5f, 0 },
-	{ 0.5f, -0.5f, 0 },
-	{ 0.5f, 0.5f, 0 },
-	{ -0.5f, 0.5f, 0 }
-}};
-
-sbuff<u32[3], 10> quad_triangles = {{
-    {0, 1, 2}, //face front
-    {0, 2, 3}
-}};
-
-
-sbuff<vec2f, 4> quad_uvs = {{
-    {0, 0},
-    {1, 0},
-    {1, 1},
-    {0, 1}
-}};
-
-Mesh quad_mesh = {
-    { begin(&quad_vrt_positions), cap(&quad_vrt_positions) }, 
-    { begin(&quad_triangles), cap(&quad_triangles) }
-};
-
-u32 quad_vao;
-u32 quad_vbo;
-u32 quad_ibo;
+
 u32 mvp_mat_loc;
 
 u32 stream_vao;
 u32 stream_vbo;
 
+u32 particle_shader;
+
+struct {
+    vec4f color = {0.2f, 0.5f, 1, 0.8f};
+    vec2f block_size = {4, 4};
+} Particle_Tool;
+
 namespace Editor {
     Physics_Object* selected_object = null;
 
+    // every selected body by index, selected_object is the one shown in the inspector
+    darr<u32> selection;
+    darr<u8> selection_mask;
+
+    // the object list shows filtered_indices, rebuilt only when the filter or the objects change
+    ImGuiTextFilter name_filter;
+    i32 type_filter = 0;
+    i32 static_filter = 0;
+    darr<u32> filtered_indices;
+    bool is_filter_dirty = true;
+    u32 filtered_objects_len = 0;
+
+    darr<u32> query_result;
+
+    // index of selected_object, pointers don't survive the objects buffer moving
+    u32 selected_index = physics_removed_index;
+
     void place_object();
+    void set_selected(u32 index);
+    void on_physics_remap(const u32* remap, u32 old_len);
+    void clear_selection();
+    void select(u32 index, bool is_toggle);
+    bool is_selected(u32 index);
+    void box_select(Box_Collider2D box, bool is_additive);
+    void update_filter();
 }
 
 namespace Builder {
 
     Physics_Object* selected_object = null;
 
-    sarr<Physics_Object, 2> objects = {{
+    // loaded from the prefab file, objects holds the built in ones when it's missing
+    Prefab_Library library;
+
+    sarr<Physics_Object, 2> default_objects = {{
         {
             "Box", { {}, {1, 0, 0, 0}, {1, 1, 1} },
             { .type = Collider_Type::Box_Collider2D, 
@@ -83,28 +94,47 @@ namespace Builder {
     }};
 
     void init_objects() {
-        objects[0].name = "Box";
-        objects[0].transform = { {}, {1, 0, 0, 0}, {1, 1, 1} };
-        objects[0].collider = { .type = Collider_Type::Box_Collider2D, 
-        .box_collider2d = {{-0.5f, -0.5f}, {0.5f, 0.5f}}};
-        objects[0].physics_data = { 1, {}, false };
-        objects[0].material = { 0, 0, {1, 1, 1, 1}};
+        init(&library, 16);
+        const char* file_name = "Assets/Prefabs/prefabs.txt";
+        if (load_prefabs(&library, file_name) && len(&library.objects) > 0)
+            return;
+        printf("no prefabs in %s, using the built in ones\n", file_name);
+        for (u32 i = 0; i < cap(&default_objects); i++) {
+            add_prefab(&library, default_objects[i].name, default_objects[i]);
+        }
     }
-}
 
-struct Camera {
-    Transform transform;
-    vec2f pixels_per_unit;
-};
+    struct {
+        i32 count = 10000;
+        f32 radius = 20;
+        f32 speed = 20;
+        darr<vec2f> positions;
+        darr<vec2f> velocities;
+    } Debris;
+
+    // Debris.count copies of the selected prefab scattered around center, flying outwards
+    void spawn_debris(vec2f center) {
+        if (selected_object == null || Debris.count <= 0)
+            return;
+        u32 count = Debris.count;
+        fit_len(&Debris.positions, count);
+        fit_len(&Debris.velocities, count);
+        for (u32 i = 0; i < count; i++) {
+            f32 angle = rand() / (f32)RAND_MAX * 2 * M_PI;
+            f32 r = sqrtf(rand() / (f32)RAND_MAX) * Debris.radius;
+            vec2f dir = { cosf(angle), sinf(angle) };
+            Debris.positions[i] = center + dir * r;
+            Debris.velocities[i] = dir * (Debris.speed * (0.5f + rand() / (f32)RAND_MAX));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        spawn_physics_objects(selected_object, begin(&Debris.positions), begin(&Debris.velocities), count);
+        f32 ms = std::chrono::duration<f32, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printf("spawned %u x %s in %.3f ms\n", count, selected_object->name, ms);
+        Editor::is_filter_dirty = true;
+    }
+}
 
-Camera camera = {
-    {
-    { 0, 0, 0 },
-    { 1, 0, 0, 0},
-    { 0.5, 0.5, 0.5 }
-    },
-    {100, 100}
-};
 
 Camera* main_camera;
 
@@ -114,113 +144,387 @@ struct {
 
     bool is_moving_selected_object = false;
     vec2f moving_selected_object_offset;
+
+    bool is_box_selecting = false;
+    vec2f box_select_start;
+    ImVec2 box_select_screen_start;
 } Mouse_Tool;
 
+struct {
+    Perf_Counter cache_misses;
+    // running averages over recent steps
+    f32 step_ms = 0;
+    f32 cache_misses_per_step = 0;
+
+    f32 unsorted_step_ms = 0;
+    f32 unsorted_cache_misses = 0;
+    f32 sorted_step_ms = 0;
+    f32 sorted_cache_misses = 0;
+
+    f32 full_rate_step_ms = 0;
+    f32 lod_step_ms = 0;
+    f32 lod_active_per_step = 0;
+} Step_Stats;
+
+struct {
+    u32 begin_count = 0;
+    u32 stay_count = 0;
+    u32 end_count = 0;
+    // most recent begin/end events, newest last
+    sbuff<Contact_Event, 8> recent;
+    u32 recent_count = 0;
+} Contact_Log;
+
 
 void save_physics_objects(const char* file_name) {
-    FILE* file = fopen(file_name, "wb");
-    fwrite(&Sandbox_Settings, sizeof(Sandbox_Settings), 1, file);
-    fwrite(&camera, sizeof(Camera), 1, file);
-    fwrite(&physics_objects.len, sizeof(u32), 1, file);
-    fwrite(physics_objects.buffer, sizeof(Physics_Object), physics_objects.len, file);
-    fclose(file);
+    write_scene_file(file_name);
+}
+
+// everything that indexes physics_objects, for when the whole array is replaced
+void reset_scene_state() {
+    Editor::clear_selection();
+    Editor::is_filter_dirty = true;
+    reset_contacts();
+    // chunk bookkeeping described the previous scene
+    World_Streaming.is_enabled = false;
+    reset_world_streaming();
+    reset_sim_lod();
 }
 
 void load_physics_objects(const char* file_name) {
-    FILE* file = fopen(file_name, "rb");
-    if (file == null) 
+    if (!read_scene_file(file_name))
         return;
+    reset_scene_state();
+}
 
-    fread(&Sandbox_Settings, sizeof(Sandbox_Settings), 1, file);
-    fread(&camera, sizeof(Camera), 1, file);
-    u32 len;
-    fread(&len, sizeof(u32), 1, file);
-    init(&physics_objects, len);
-    physics_objects.len = len;
-    fread(physics_objects.buffer, sizeof(Physics_Object), len, file);
+// replaces the scene with the bodies of a CSV / JSON lines file, a file that
+// can't be opened leaves the scene alone
+void import_physics_objects(const char* file_name) {
+    FILE* file = fopen(file_name, "rb");
+    if (file == null) {
+        printf("failed to open %s\n", file_name);
+        return;
+    }
+    // before the first body goes in, remaps sent while importing must not reach state of the old scene
+    physics_objects.len = 0;
+    reset_scene_state();
+    import_scene(file, file_name);
     fclose(file);
 }
 
-void render_quads() {
-    bind_shader(Assets::shaders[0].id);
+// reads the events of every step run this frame in one go
+void consume_contact_events() {
+    Contact_Log.begin_count = 0;
+    Contact_Log.stay_count = 0;
+    Contact_Log.end_count = 0;
+    for (auto it = begin(&contacts.events); it != end(&contacts.events); it++) {
+        switch (it->type) {
+            case Contact_Begin: Contact_Log.begin_count++; break;
+            case Contact_Stay: Contact_Log.stay_count++; break;
+            case Contact_End: Contact_Log.end_count++; break;
+        }
+        if (it->type != Contact_Stay) {
+            u32 slot_count = cap(&Contact_Log.recent);
+            if (Contact_Log.recent_count == slot_count) {
+                memmove(&Contact_Log.recent[0], &Contact_Log.recent[1], sizeof(Contact_Event) * (slot_count - 1));
+                Contact_Log.recent_count--;
+            }
+            Contact_Log.recent[Contact_Log.recent_count++] = *it;
+        }
+    }
+    clear_contact_events();
+}
 
-    bind_vao(quad_vao);
-    bind_ibo(quad_ibo);
+void timed_physics_update() {
+    u64 misses_start = read_counter(&Step_Stats.cache_misses);
+    auto start = std::chrono::steady_clock::now();
 
-    mat4f vp_m = proj_xy_orth_matrix(window_size, main_camera->pixels_per_unit, {-1, 30}) * view_matrix(&main_camera->transform);
+    physics_update();
+    record_state_hash();
 
-    for (auto it = begin(&physics_objects); it != end(&physics_objects); it++) {
-        i32 texture_slot = 0;
-        bind_texture(Assets::textures[it->material.texture_name].id, texture_slot);
+    f32 ms = std::chrono::duration<f32, std::milli>(std::chrono::steady_clock::now() - start).count();
+    f32 misses = (f32)(read_counter(&Step_Stats.cache_misses) - misses_start);
+    Step_Stats.step_ms = Step_Stats.step_ms * 0.95f + ms * 0.05f;
+    Step_Stats.cache_misses_per_step = Step_Stats.cache_misses_per_step * 0.95f + misses * 0.05f;
+}
+
+// steps the scene as it is and after a morton sort, the scene is rewound after
+// each run so only the sort itself is kept
+void benchmark_morton_sort(u32 step_count) {
+    u32 count = len(&physics_objects);
+    if (count == 0)
+        return;
 
-        set_uniform(&Assets::shaders[0], 1, texture_slot);
-        vec4f color = it->material.color;
-        set_uniform(&Assets::shaders[0], 2, color);
+    darr<Physics_Object> snapshot;
+    init(&snapshot, count);
+    snapshot.len = count;
 
-        mat4f mvp_m = vp_m * model_matrix(&it->transform);
-        set_uniform(&Assets::shaders[0], 0, mvp_m);
+    bool was_enabled = Morton_Sort.is_enabled;
+    Morton_Sort.is_enabled = false;
 
-        glDrawElements(GL_TRIANGLES, cap(&quad_mesh.index_buffer) * 3, GL_UNSIGNED_INT, null);
+    // the rewound steps must not leave events or pairs in the live contacts
+    Contact_State bench_contacts;
+    init(&bench_contacts);
+
+    f32* results[2][2] = {
+        { &Step_Stats.unsorted_step_ms, &Step_Stats.unsorted_cache_misses },
+        { &Step_Stats.sorted_step_ms, &Step_Stats.sorted_cache_misses }
+    };
+    for (u32 run = 0; run < 2; run++) {
+        if (run == 1) {
+            morton_sort_physics_objects();
+        }
+        memcpy(begin(&snapshot), begin(&physics_objects), sizeof(Physics_Object) * count);
+
+        u64 misses_start = read_counter(&Step_Stats.cache_misses);
+        std::swap(contacts, bench_contacts);
+        // full rate steps, set aside around the steps only so the sort above still remaps the live lod state
+        Sim_Lod_Type live_lod;
+        stash_sim_lod(&live_lod);
+        Sim_Lod.is_enabled = false;
+        auto start = std::chrono::steady_clock::now();
+        for (u32 i = 0; i < step_count; i++) {
+            physics_update();
+        }
+        *results[run][0] = std::chrono::duration<f32, std::milli>(std::chrono::steady_clock::now() - start).count() / step_count;
+        *results[run][1] = (f32)(read_counter(&Step_Stats.cache_misses) - misses_start) / step_count;
+        std::swap(contacts, bench_contacts);
+        unstash_sim_lod(&live_lod);
+        // both runs start without contacts
+        bench_contacts.current.len = 0;
+        bench_contacts.previous.len = 0;
+        bench_contacts.events.len = 0;
+
+        memcpy(begin(&physics_objects), begin(&snapshot), sizeof(Physics_Object) * count);
     }
+
+    Morton_Sort.is_enabled = was_enabled;
+    shut(&bench_contacts);
+    shut(&snapshot);
+
+    printf("morton sort benchmark, %u bodies, %u steps\n", count, step_count);
+    printf("  unsorted: %.4f ms/step, %.0f cache misses/step\n", Step_Stats.unsorted_step_ms, Step_Stats.unsorted_cache_misses);
+    printf("  sorted:   %.4f ms/step, %.0f cache misses/step\n", Step_Stats.sorted_step_ms, Step_Stats.sorted_cache_misses);
 }
 
-void render_colliders() {
-    bind_shader(Assets::shaders[0].id);
+// steps the scene at full rate and with the lod settings and points as they are,
+// the scene is rewound after each run and the live lod state is left alone
+void benchmark_sim_lod(u32 step_count) {
+    u32 count = len(&physics_objects);
+    if (count == 0)
+        return;
 
-    bind_vao(quad_vao);
-    bind_ibo(quad_ibo);
+    darr<Physics_Object> snapshot;
+    init(&snapshot, count);
+    snapshot.len = count;
+    memcpy(begin(&snapshot), begin(&physics_objects), sizeof(Physics_Object) * count);
+
+    bool was_sorted = Morton_Sort.is_enabled;
+    Morton_Sort.is_enabled = false;
+    Contact_State bench_contacts;
+    init(&bench_contacts);
+
+    f32* results[2] = { &Step_Stats.full_rate_step_ms, &Step_Stats.lod_step_ms };
+    for (u32 run = 0; run < 2; run++) {
+        Sim_Lod_Type live_lod;
+        stash_sim_lod(&live_lod);
+        Sim_Lod.is_enabled = (run == 1);
+        std::swap(contacts, bench_contacts);
+
+        u64 active_total = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (u32 i = 0; i < step_count; i++) {
+            physics_update();
+            active_total += (run == 1 ? Sim_Lod.active_count : count);
+        }
+        *results[run] = std::chrono::duration<f32, std::milli>(std::chrono::steady_clock::now() - start).count() / step_count;
+        if (run == 1) {
+            Step_Stats.lod_active_per_step = (f32)active_total / step_count;
+        }
 
-    i32 texture_slot = 1;
+        std::swap(contacts, bench_contacts);
+        unstash_sim_lod(&live_lod);
+        bench_contacts.current.len = 0;
+        bench_contacts.previous.len = 0;
+        bench_contacts.events.len = 0;
+        memcpy(begin(&physics_objects), begin(&snapshot), sizeof(Physics_Object) * count);
+    }
 
-    set_uniform(&Assets::shaders[0], 1, texture_slot);
+    Morton_Sort.is_enabled = was_sorted;
+    shut(&bench_contacts);
+    shut(&snapshot);
 
+    printf("simulation lod benchmark, %u bodies, %u steps\n", count, step_count);
+    printf("  full rate: %.4f ms/step\n", Step_Stats.full_rate_step_ms);
+    printf("  lod:       %.4f ms/step, %.0f bodies stepped per tick\n", Step_Stats.lod_step_ms, Step_Stats.lod_active_per_step);
+}
 
-    mat4f vp_m = proj_xy_orth_matrix(window_size, main_camera->pixels_per_unit, {-1, 30}) * view_matrix(&main_camera->transform);
+mat4f main_camera_vp_matrix() {
+    return proj_xy_orth_matrix(window_size, main_camera->pixels_per_unit, {-1, 30}) * view_matrix(&main_camera->transform);
+}
 
-    for (auto it = begin(&physics_objects); it != end(&physics_objects); it++) {
-        mat4f mvp_m;
-        if (it->collider.type == Collider_Type::Box_Collider2D) {
-            bind_texture(Assets::textures[2].id, texture_slot);
+void render_particles() {
+    Particle_System* ps = &particle_system;
+    if (ps->count == 0)
+        return;
 
-            Box_Collider2D& bc = it->collider.box_collider2d;
-            vec2f collider_size = bc.rt - bc.lb;
-            vec2f collider_center = (bc.rt + bc.lb) / 2.0f;
-            Transform t = it->transform;
-            t.position += vec3f(collider_center.x, collider_center.y, 0);
-            t.scale = { t.scale.x * collider_size.x, t.scale.y * collider_size.y, t.scale.z };
-            mvp_m = vp_m * model_matrix(&t);
-        } else if (it->collider.type == Collider_Type::Sphere_Collider2D) {
-            bind_texture(Assets::textures[3].id, texture_slot);
+    bind_shader(particle_shader);
+    bind_vao(stream_vao);
+
+    // x and y go as two separate instance attributes straight from the SoA arrays
+    u64 size = sizeof(f32) * ps->count;
+    glBindBuffer(GL_ARRAY_BUFFER, stream_vbo);
+    glBufferData(GL_ARRAY_BUFFER, size * 2, null, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, ps->pos_x);
+    glBufferSubData(GL_ARRAY_BUFFER, size, size, ps->pos_y);
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 0, 0);
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, 0, (void*)size);
+
+    mat4f vp_m = main_camera_vp_matrix();
+    glUniformMatrix4fv(glGetUniformLocation(particle_shader, "u_vp_mat"), 1, GL_TRUE, (f32*)&vp_m);
+    glUniform1f(glGetUniformLocation(particle_shader, "u_size"), ps->params.smoothing_radius * 0.5f);
+    glUniform4fv(glGetUniformLocation(particle_shader, "u_color"), 1, (f32*)&Particle_Tool.color);
+
+    glDrawElementsInstanced(GL_TRIANGLES, cap(&quad_mesh.index_buffer) * 3, GL_UNSIGNED_INT, null, ps->count);
+    render_stats.draw_calls++;
+    render_stats.shader_binds++;
+    render_stats.vao_binds++;
+    render_stats.uniform_sets += 3;
+}
 
-            Sphere_Collider2D& c = it->collider.sphere_collider2d;
-            Transform t = it->transform;
-            t.position += vec3f(c.origin.x, c.origin.y, 0);
-            t.scale = { max(t.scale.x, t.scale.y) * 2 * c.radius, max(t.scale.x, t.scale.y)* 2 * c.radius, t.scale.z };
-            mvp_m = vp_m * model_matrix(&t);
+void Editor::place_object() {
+    vec2f cursor_world_pos = screen_to_world_space(Input::mouse_position, main_camera->transform, window_size, main_camera->pixels_per_unit);
+    bool is_toggle = ImGui::GetIO().KeyCtrl;
+    Physics_Object* hit_object = is_over(cursor_world_pos);
+    if (hit_object != null) {
+        Editor::select(hit_object - begin(&physics_objects), is_toggle);
+        if (Editor::selected_object != null) {
+            Mouse_Tool.is_moving_selected_object = true;
+            Mouse_Tool.moving_selected_object_offset = (vec2f)selected_object->transform.position - cursor_world_pos;
         }
+        return;
+    }
+    if (is_toggle)
+        return;
+    Editor::clear_selection();
 
-        set_uniform(&Assets::shaders[0], 0, mvp_m);
-        vec4f color = ( it == Editor::selected_object ? vec4f{ 1, 1, 1, 0.8f } : vec4f{ 1, 1, 1, 0.5f } );
-        set_uniform(&Assets::shaders[0], 2, color);
+    if (Builder::selected_object != null) {
+        spawn_physics_objects(Builder::selected_object, &cursor_world_pos, null, 1);
+    }
+}
 
-        glDrawElements(GL_TRIANGLES, cap(&quad_mesh.index_buffer) * 3, GL_UNSIGNED_INT, null);
+void sync_selection_mask() {
+    fit_len(&Editor::selection_mask, len(&physics_objects));
+    memset(begin(&Editor::selection_mask), 0, len(&Editor::selection_mask));
+    for (auto it = begin(&Editor::selection); it != end(&Editor::selection); it++) {
+        Editor::selection_mask[*it] = 1;
     }
 }
 
-void Editor::place_object() {
-    vec2f cursor_world_pos = screen_to_world_space(Input::mouse_position, main_camera->transform, window_size, main_camera->pixels_per_unit);
-    Editor::selected_object = is_over(cursor_world_pos);
-    if (Editor::selected_object != null) {
-        Mouse_Tool.is_moving_selected_object = true;
-        Mouse_Tool.moving_selected_object_offset = (vec2f)selected_object->transform.position - cursor_world_pos;
+void Editor::on_physics_remap(const u32* remap, u32 old_len) {
+    is_filter_dirty = true;
+
+    u32 new_len = 0;
+    for (u32 i = 0; i < len(&selection); i++) {
+        u32 new_index = remap[selection[i]];
+        if (new_index != physics_removed_index) {
+            selection[new_len++] = new_index;
+        }
+    }
+    selection.len = new_len;
+    sync_selection_mask();
+
+    if (selected_index == physics_removed_index)
         return;
+
+    set_selected(remap[selected_index]);
+    if (selected_object == null) {
+        Mouse_Tool.is_moving_selected_object = false;
     }
+}
 
-    if (Builder::selected_object != null) {
-        Physics_Object obj = *Builder::selected_object;
-        obj.transform.position = {cursor_world_pos.x, cursor_world_pos.y, 0};
+// physics_removed_index clears it
+void Editor::set_selected(u32 index) {
+    selected_index = index;
+    selected_object = (index == physics_removed_index ? null : &physics_objects[index]);
+}
+
+void Editor::clear_selection() {
+    selection.len = 0;
+    set_selected(physics_removed_index);
+    sync_selection_mask();
+}
+
+bool Editor::is_selected(u32 index) {
+    return index < len(&selection_mask) && selection_mask[index];
+}
+
+// plain click selects only index, toggle adds or removes it from the selection
+void Editor::select(u32 index, bool is_toggle) {
+    if (!is_toggle) {
+        selection.len = 0;
+        dpush(&selection, index);
+        set_selected(index);
+    } else if (is_selected(index)) {
+        u32 i = 0;
+        for (; selection[i] != index; i++);
+        memmove(&selection[i], &selection[i + 1], sizeof(u32) * (len(&selection) - i - 1));
+        selection.len--;
+        if (selected_index == index) {
+            set_selected(len(&selection) > 0 ? selection[len(&selection) - 1] : physics_removed_index);
+        }
+    } else {
+        dpush(&selection, index);
+        set_selected(index);
+    }
+    sync_selection_mask();
+}
+
+void Editor::box_select(Box_Collider2D box, bool is_additive) {
+    if (!is_additive) {
+        clear_selection();
+    }
+    // bodies added since the last sync have no mask entry yet
+    sync_selection_mask();
+    query_aabb(box, &query_result);
+    for (auto it = begin(&query_result); it != end(&query_result); it++) {
+        if (!is_selected(*it)) {
+            dpush(&selection, *it);
+            selection_mask[*it] = 1;
+        }
+    }
+    if (selected_object == null && len(&selection) > 0) {
+        set_selected(selection[0]);
+    }
+}
 
-        dpush(&physics_objects, obj);
+void Editor::update_filter() {
+    if (!is_filter_dirty && filtered_objects_len == len(&physics_objects))
+        return;
+
+    filtered_indices.len = 0;
+    for (u32 i = 0; i < len(&physics_objects); i++) {
+        Physics_Object& obj = physics_objects[i];
+        if (type_filter != 0 && (i32)obj.collider.type != type_filter - 1)
+            continue;
+        if ((static_filter == 1 && !obj.physics_data.is_static) || (static_filter == 2 && obj.physics_data.is_static))
+            continue;
+        if (!name_filter.PassFilter(obj.name))
+            continue;
+        dpush(&filtered_indices, i);
+    }
+    is_filter_dirty = false;
+    filtered_objects_len = len(&physics_objects);
+}
+
+namespace Editor {
+    // batched edits, f(Physics_Object*) over the whole selection in one pass
+    template <typename F>
+    void for_each_selected(F f) {
+        for (auto it = begin(&selection); it != end(&selection); it++) {
+            f(&physics_objects[*it]);
+        }
+        is_filter_dirty = true;
     }
 }
 
@@ -249,39 +553,34 @@ void explosion_effect() {
 void game_init() {
     Input::input_init();
 
-    Assets::load_shaders<1>({"Assets/Shaders/sprite.glsl"});
-    init(&Assets::shaders[0], 3);
-    add_uniform(&Assets::shaders[0], "u_mpv_mat", Type::mat4f);
-    add_uniform(&Assets::shaders[0], "u_texture", Type::i32);
-    add_uniform(&Assets::shaders[0], "u_color", Type::vec4f);
+    u64 assets_start = SDL_GetPerformanceCounter();
 
-    Assets::load_textures<4>({
-        "Assets/Textures/SquareTexture.png", "Assets/Textures/CircleTexture.png",
-        "Assets/Textures/BoxCollider2D.png", "Assets/Textures/SphereCollider2D.png"});
+    bool is_bundle_loaded = load_render_assets();
 
+    f64 assets_ms = (f64)(SDL_GetPerformanceCounter() - assets_start) * 1000 / SDL_GetPerformanceFrequency();
+    printf("assets loaded in %.2f ms (%s)\n", assets_ms, is_bundle_loaded ? "bundle" : "loose files");
 
-    glGenVertexArrays(1, &quad_vao);
-    glBindVertexArray(quad_vao);
+    init_quad_mesh();
+    Builder::init_objects();
 
-    // make buffer for triangle
-    glGenBuffers(1, &quad_vbo);
+    // particle batch: quad vertices per vertex, particle positions per instance
+    glGenVertexArrays(1, &stream_vao);
+    glBindVertexArray(stream_vao);
     glBindBuffer(GL_ARRAY_BUFFER, quad_vbo);
-
-    // allocates vram
-    glBufferData(GL_ARRAY_BUFFER, size(&quad_mesh.vertex_buffer) + sizeof(quad_uvs), null, GL_STATIC_DRAW);
-    
-    glBufferSubData(GL_ARRAY_BUFFER, 0, size(&quad_mesh.vertex_buffer), begin(&quad_mesh.vertex_buffer));
-    glBufferSubData(GL_ARRAY_BUFFER, size(&quad_mesh.vertex_buffer), sizeof(quad_uvs), begin(&quad_uvs));
-
     glEnableVertexAttribArray(0);
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)size(&quad_mesh.vertex_buffer));
-
-    glGenBuffers(1, &quad_ibo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, size(&quad_mesh.index_buffer), begin(&quad_mesh.index_buffer), GL_STATIC_DRAW);
 
+    glGenBuffers(1, &stream_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, stream_vbo);
+    glEnableVertexAttribArray(2);
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(2, 1);
+    glVertexAttribDivisor(3, 1);
+
+    particle_shader = Assets::load_shader_program("Assets/assets.bundle", "particle", "Assets/Shaders/particle.glsl");
 
     glUseProgram(Assets::shaders[0].id);
     
@@ -299,11 +598,31 @@ void game_init() {
 
     load_physics_objects("Saves/save.bin");
 
+    Jobs::init();
+    init(&particle_system, 1024);
+
+    init(&Editor::selection, 16);
+    init(&Editor::filtered_indices, 16);
+    init(&Editor::query_result, 16);
+    add_physics_remap_listener(Editor::on_physics_remap);
+    add_physics_remap_listener(on_contacts_remap);
+    add_physics_remap_listener(on_sim_lod_remap);
+    open_cache_miss_counter(&Step_Stats.cache_misses);
+    init_world_streaming();
+
     GTime::fixed_dt = 1.0f / 360;
+    init_step_budget(GTime::fixed_dt);
 }
 
 void game_shut() {
     Input::input_shut();
+    Jobs::shut();
+    if (World_Streaming.is_enabled) {
+        flush_world_streaming();
+    }
+    shut_world_streaming();
+    close_counter(&Step_Stats.cache_misses);
+    shut(&Builder::library);
 }
 
 
@@ -346,7 +665,14 @@ void game_update() {
 
     if (!gui_io.WantCaptureMouse) {
         if (Input::is_mouse_button_down(0)) {
-            Editor::place_object();
+            if (gui_io.KeyShift) {
+                Mouse_Tool.is_box_selecting = true;
+                Mouse_Tool.box_select_start = screen_to_world_space(Input::mouse_position, 
+                    main_camera->transform, window_size, main_camera->pixels_per_unit);
+                Mouse_Tool.box_select_screen_start = gui_io.MousePos;
+            } else {
+                Editor::place_object();
+            }
         }
         if (Input::is_mouse_button_down(2)) {
             explosion_effect();
@@ -374,22 +700,43 @@ void game_update() {
 
     if (Input::is_mouse_button_up(0)) {
         Mouse_Tool.is_moving_selected_object = false;
+
+        if (Mouse_Tool.is_box_selecting) {
+            vec2f p1 = Mouse_Tool.box_select_start;
+            vec2f p2 = screen_to_world_space(Input::mouse_position, main_camera->transform, window_size, main_camera->pixels_per_unit);
+            Box_Collider2D box = { { min(p1.x, p2.x), min(p1.y, p2.y) }, { max(p1.x, p2.x), max(p1.y, p2.y) } };
+            Editor::box_select(box, gui_io.KeyCtrl);
+            Mouse_Tool.is_box_selecting = false;
+        }
     }
     if (Mouse_Tool.is_moving_selected_object) {
         vec2f cursor_world_pos = screen_to_world_space(Input::mouse_position, main_camera->transform, window_size, main_camera->pixels_per_unit);
         Editor::selected_object->transform.position = vec3f(cursor_world_pos + Mouse_Tool.moving_selected_object_offset, 0);
     }
 
-    render_quads();
-    if (Sandbox_Settings.are_colliders_rendered)
-        render_colliders();
+    vec2f view_half_size = { window_size.x / main_camera->pixels_per_unit.x / 2, window_size.y / main_camera->pixels_per_unit.y / 2 };
+    update_world_streaming((vec2f)main_camera->transform.position, view_half_size);
+    clear_sim_lod_points();
+    add_sim_lod_point((vec2f)main_camera->transform.position);
 
-    static f32 cur_dt = 0;
-    cur_dt += GTime::dt;
-    for (; cur_dt >= GTime::fixed_dt; cur_dt -= GTime::fixed_dt) {
-        if (Sandbox_Settings.is_physics_updated)
-            physics_update();  
+    render_stats = {};
+    mat4f vp_m = main_camera_vp_matrix();
+    render_quads(vp_m);
+    render_particles();
+    if (Sandbox_Settings.are_colliders_rendered)
+        render_colliders(vp_m, &Editor::selection_mask);
+
+    if (Sandbox_Settings.is_physics_updated) {
+        u32 step_count = plan_physics_steps(GTime::dt);
+        GTime::fixed_dt = step_budget_dt();
+        auto steps_start = std::chrono::steady_clock::now();
+        for (u32 i = 0; i < step_count; i++) {
+            timed_physics_update();
+        }
+        finish_physics_steps(step_count, std::chrono::duration<f32, std::milli>(std::chrono::steady_clock::now() - steps_start).count());
+        particles_update(&particle_system, GTime::dt * step_budget_time_scale());
     }
+    consume_contact_events();
 
     // cube_transform.position += vec3f(0.5, 0.5, -1);
     // to_mat4(&tr_m, &cube_transform);
@@ -403,12 +750,220 @@ void game_update() {
 #if GUI_ENABLED
 #include "gpu_graphics/import/imgui/imgui_demo.cpp"
 void draw_gui() {
+    ImGuiIO& gui_io = ImGui::GetIO();
+
+    if (Mouse_Tool.is_box_selecting) {
+        ImDrawList* draw_list = ImGui::GetForegroundDrawList();
+        draw_list->AddRectFilled(Mouse_Tool.box_select_screen_start, gui_io.MousePos, IM_COL32(255, 255, 255, 30));
+        draw_list->AddRect(Mouse_Tool.box_select_screen_start, gui_io.MousePos, IM_COL32(255, 255, 255, 200));
+    }
+
     ImGui::Begin("Properties");
     // ImGui::ShowDemoWindow();
     ImGui::Text("fps: %f, dt: %f", 1 / GTime::dt, GTime::dt);
 
     ImGui::Checkbox("Update Physics", &Sandbox_Settings.is_physics_updated);
     ImGui::Checkbox("Render Colliders", &Sandbox_Settings.are_colliders_rendered);
+    ImGui::Text("draw calls: %u, state changes: %u", render_stats.draw_calls, state_changes(&render_stats));
+
+    if (ImGui::CollapsingHeader("Memory Layout")) {
+        ImGui::Text("step: %.4f ms, cache misses: %.0f", Step_Stats.step_ms, Step_Stats.cache_misses_per_step);
+        ImGui::Checkbox("Morton Sort", &Morton_Sort.is_enabled);
+        ImGui::TextWrapped("Sorting changes the order pairs are resolved in, so it changes the results too. "
+            "Every pair is still tested, so the timings below differ mostly by noise.");
+        i32 interval = Morton_Sort.interval;
+        ImGui::SliderInt("Sort Interval (steps)", &interval, 1, 3600);
+        Morton_Sort.interval = interval;
+        if (ImGui::Button("Sort Now")) {
+            morton_sort_physics_objects();
+        }
+        ImGui::SameLine();
+        ImGui::Text("last sort: %.3f ms", Morton_Sort.last_sort_ms);
+
+        if (ImGui::Button("Benchmark")) {
+            benchmark_morton_sort(360);
+        }
+        ImGui::Text("unsorted: %.4f ms, %.0f misses / step", Step_Stats.unsorted_step_ms, Step_Stats.unsorted_cache_misses);
+        ImGui::Text("sorted:   %.4f ms, %.0f misses / step", Step_Stats.sorted_step_ms, Step_Stats.sorted_cache_misses);
+    }
+
+    if (ImGui::CollapsingHeader("Step Budget")) {
+        ImGui::Text("%.0f Hz at %.2fx, level %u", 1 / step_budget_dt(), step_budget_time_scale(), Step_Budget.level);
+        ImGui::Text("step: %.4f ms, frame: %u/%u steps, %.2f ms", Step_Budget.step_ms,
+            Step_Budget.steps_run, Step_Budget.steps_wanted, Step_Budget.frame_ms);
+        ImGui::Text("dropped: %.2f ms this frame, %.2f s total, %u level changes",
+            Step_Budget.dropped_ms, Step_Budget.total_dropped_s, Step_Budget.level_changes);
+
+        ImGui::Checkbox("Enforce Budget", &Step_Budget.is_enabled);
+        ImGui::SliderFloat("Budget (ms)", &Step_Budget.budget_ms, 0.5f, 33);
+        i32 max_steps = Step_Budget.max_steps_per_frame;
+        ImGui::SliderInt("Max Steps per Frame", &max_steps, 1, 128);
+        Step_Budget.max_steps_per_frame = max_steps;
+    }
+
+    if (ImGui::CollapsingHeader("Simulation LOD")) {
+        ImGui::Text("near %u, mid %u, far %u, stepped last tick: %u", Sim_Lod.tier_counts[Sim_Near],
+            Sim_Lod.tier_counts[Sim_Mid], Sim_Lod.tier_counts[Sim_Far], Sim_Lod.active_count);
+        // with the near radius above this, coarse stepping stays off screen
+        vec2f view_half_size = { window_size.x / main_camera->pixels_per_unit.x / 2, window_size.y / main_camera->pixels_per_unit.y / 2 };
+        ImGui::Text("view radius: %.1f", magnitude(view_half_size));
+
+        ImGui::Checkbox("Enable LOD", &Sim_Lod.is_enabled);
+        ImGui::SliderFloat("Near Radius", &Sim_Lod.near_radius, 1, 500);
+        ImGui::SliderFloat("Mid Radius", &Sim_Lod.mid_radius, Sim_Lod.near_radius, 2000);
+        i32 mid_interval = Sim_Lod.mid_interval;
+        ImGui::SliderInt("Mid Interval (ticks)", &mid_interval, 2, 4);
+        Sim_Lod.mid_interval = mid_interval;
+        bool is_far_coarse = Sim_Lod.far_mode == Far_Mode::Coarse;
+        ImGui::Checkbox("Step Far Bodies Coarsely", &is_far_coarse);
+        Sim_Lod.far_mode = (is_far_coarse ? Far_Mode::Coarse : Far_Mode::Frozen);
+        if (is_far_coarse) {
+            i32 far_interval = Sim_Lod.far_interval;
+            ImGui::SliderInt("Far Interval (ticks)", &far_interval, 8, 360);
+            Sim_Lod.far_interval = far_interval;
+        }
+
+        if (ImGui::Button("Benchmark##lod")) {
+            benchmark_sim_lod(360);
+        }
+        ImGui::Text("full rate: %.4f ms / step", Step_Stats.full_rate_step_ms);
+        ImGui::Text("lod:       %.4f ms / step, %.0f bodies stepped", Step_Stats.lod_step_ms, Step_Stats.lod_active_per_step);
+    }
+
+    if (ImGui::CollapsingHeader("World Streaming")) {
+        u32 loaded_count = 0;
+        for (auto it = begin(&World_Streaming.chunks); it != end(&World_Streaming.chunks); it++) {
+            loaded_count += (it->state == Chunk_State::Loaded);
+        }
+        ImGui::Text("chunks: %u loaded, %u pending, io queue: %u", loaded_count,
+            len(&World_Streaming.chunks) - loaded_count, world_streaming_queue_len());
+        ImGui::Text("bodies in memory: %u (%.1f MB)", len(&physics_objects),
+            len(&physics_objects) * sizeof(Physics_Object) / (1024.0f * 1024.0f));
+
+        ImGui::Checkbox("Stream Chunks", &World_Streaming.is_enabled);
+        ImGui::SliderFloat("Margin", &World_Streaming.margin, 0, 200);
+        i32 budget = World_Streaming.integration_budget;
+        ImGui::SliderInt("Bodies Loaded per Frame", &budget, 100, 100000);
+        World_Streaming.integration_budget = budget;
+
+        // chunk layout only changes while nothing is streamed
+        if (!World_Streaming.is_enabled) {
+            ImGui::SliderFloat("Chunk Size", &World_Streaming.chunk_size, 4, 256);
+            ImGui::InputText("Chunk Directory", World_Streaming.directory, sizeof(World_Streaming.directory));
+            if (ImGui::Button("Bake Scene To Chunks")) {
+                bake_world_chunks();
+            }
+            ImGui::SameLine();
+            ImGui::TextDisabled("empties the scene");
+        } else {
+            if (ImGui::Button("Flush To Disk")) {
+                flush_world_streaming();
+            }
+            ImGui::SameLine();
+            ImGui::TextDisabled("empties the scene and stops streaming");
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Contact Events")) {
+        ImGui::Text("this frame: %u begin, %u stay, %u end", Contact_Log.begin_count, Contact_Log.stay_count, Contact_Log.end_count);
+        for (u32 i = 0; i < Contact_Log.recent_count; i++) {
+            Contact_Event& e = Contact_Log.recent[i];
+            if (e.a == physics_removed_index || e.b == physics_removed_index) {
+                u32 kept = (e.a == physics_removed_index ? e.b : e.a);
+                ImGui::Text("%s %d - removed", e.type == Contact_Begin ? "begin" : "end  ", (i32)kept);
+            } else {
+                ImGui::Text("%s %u - %u", e.type == Contact_Begin ? "begin" : "end  ", e.a, e.b);
+            }
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Determinism")) {
+        ImGui::Checkbox("Hash Every Step", &State_Hash_Log.is_enabled);
+        ImGui::Text("logged steps: %u of %llu, last hash: %016llx", len(&State_Hash_Log.hashes),
+            (unsigned long long)State_Hash_Log.step_count, (unsigned long long)last_state_hash());
+        if (ImGui::Button("Save Hash Log")) {
+            save_state_hash_log("Saves/state_hashes.txt");
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Clear Hash Log")) {
+            clear_state_hash_log();
+        }
+
+        static Determinism_Config configs[2];
+        static i32 check_step_count = 360;
+        static f32 tolerance = 0;
+        static Determinism_Report report = {};
+        static bool has_report = false;
+        for (u32 i = 0; i < 2; i++) {
+            ImGui::PushID(i);
+            ImGui::Text("Config %c", 'A' + i);
+            ImGui::Checkbox("Morton Sort", &configs[i].is_morton_sorted);
+            i32 interval = configs[i].morton_interval;
+            ImGui::SliderInt("Sort Interval", &interval, 1, 360);
+            configs[i].morton_interval = interval;
+            i32 thread_count = configs[i].particle_thread_count;
+            ImGui::SliderInt("Particle Threads", &thread_count, 1, Jobs::max_thread_count());
+            configs[i].particle_thread_count = thread_count;
+            ImGui::PopID();
+        }
+        ImGui::SliderInt("Steps", &check_step_count, 1, 3600);
+        ImGui::InputFloat("Tolerance (0 = bit exact)", &tolerance, 0, 0, "%g");
+        if (ImGui::Button("Run Check")) {
+            report = check_determinism(configs[0], configs[1], check_step_count, max(tolerance, 0.0f));
+            has_report = true;
+        }
+        if (has_report) {
+            if (report.is_diverged) {
+                ImGui::Text("diverged at step %u, %s %u, error %g", report.step,
+                    report.is_particle ? "particle" : "body", report.index, report.error);
+            } else {
+                ImGui::Text("%u steps match", report.steps_run);
+            }
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Particles")) {
+        Particle_System* ps = &particle_system;
+        ImGui::Text("count: %u, step: %.3f ms", ps->count, ps->last_step_ms);
+        i32 thread_count = ps->thread_count;
+        ImGui::SliderInt("Threads", &thread_count, 1, Jobs::max_thread_count());
+        ps->thread_count = thread_count;
+
+        Particle_Params& params = ps->params;
+        ImGui::SliderFloat("Smoothing Radius", &params.smoothing_radius, 0.02f, 1);
+        ImGui::SliderFloat("Particle Mass", &params.particle_mass, 0.01f, 100);
+        ImGui::SliderFloat("Rest Density", &params.rest_density, 1, 5000);
+        ImGui::SliderFloat("Stiffness", &params.stiffness, 0, 5000);
+        ImGui::SliderFloat("Viscosity", &params.viscosity, 0, 50);
+        ImGui::SliderFloat("Restitution", &params.restitution, 0, 1);
+        ImGui::SliderFloat("Friction", &params.friction, 0, 1);
+        ImGui::SliderFloat2("Gravity", (f32*)&params.gravity, -50, 50);
+        ImGui::ColorEdit4("Particle Color", (f32*)&Particle_Tool.color);
+
+        ImGui::SliderFloat2("Block Size", (f32*)&Particle_Tool.block_size, 0.5f, 50);
+        if (ImGui::Button("Spawn Block")) {
+            // rest spacing, particle_mass / spacing^2 == rest_density
+            f32 spacing = sqrtf(params.particle_mass / params.rest_density);
+            vec2f center = (vec2f)main_camera->transform.position;
+            spawn_particle_block(ps, center - Particle_Tool.block_size / 2.0f, center + Particle_Tool.block_size / 2.0f, spacing);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Clear Particles")) {
+            clear(ps);
+        }
+
+        static i32 bench_count = 200000;
+        static Particle_Benchmark bench = {};
+        ImGui::InputInt("Benchmark Particles", &bench_count, 10000, 100000);
+        bench_count = max(bench_count, 1);
+        if (ImGui::Button("Benchmark##particles")) {
+            bench = benchmark_particles(ps, bench_count, 120, (vec2f)main_camera->transform.position);
+        }
+        if (bench.step_count > 0) {
+            ImGui::Text("%u particles: %.3f ms/step (min %.3f, max %.3f)", bench.count, bench.step_ms, bench.min_step_ms, bench.max_step_ms);
+            ImGui::Text("%.1f steps fit a 60 fps frame", bench.steps_per_frame);
+        }
+    }
 
     if (ImGui::CollapsingHeader("Other")) {
         ImGui::ColorPicker4("Background Color", (f32*)&Sandbox_Settings.clear_color);
@@ -420,19 +975,82 @@ void draw_gui() {
         ImGuiTreeNodeFlags_SpanAvailWidth | ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
     
     if (ImGui::TreeNode("Physics Objects")) {
-        for (u32 i = 0; i < len(&physics_objects); i++) {
-            ImGuiTreeNodeFlags node_flags = base_flags;
-            if (&physics_objects[i] == Editor::selected_object) {
-                node_flags |= ImGuiTreeNodeFlags_Selected;
-            }
-            ImGui::TreeNodeEx((void*)(intptr_t)(i32)i, node_flags, physics_objects[i].name);
-            if (ImGui::IsItemClicked()) {
-                Editor::selected_object = &physics_objects[i];
+        if (Editor::name_filter.Draw("Name Filter")) {
+            Editor::is_filter_dirty = true;
+        }
+        if (ImGui::Combo("Type Filter", &Editor::type_filter, "All\0Box Collider2D\0Sphere Collider2D\0\0")) {
+            Editor::is_filter_dirty = true;
+        }
+        if (ImGui::Combo("Static Filter", &Editor::static_filter, "All\0Static\0Dynamic\0\0")) {
+            Editor::is_filter_dirty = true;
+        }
+        Editor::update_filter();
+        ImGui::Text("showing %u of %u, selected %u", len(&Editor::filtered_indices), len(&physics_objects), len(&Editor::selection));
+
+        // only the visible rows are submitted
+        ImGui::BeginChild("Physics Objects List", ImVec2(0, 300), true);
+        ImGuiListClipper clipper;
+        clipper.Begin(len(&Editor::filtered_indices));
+        while (clipper.Step()) {
+            for (i32 row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                u32 i = Editor::filtered_indices[row];
+                ImGuiTreeNodeFlags node_flags = base_flags;
+                if (Editor::is_selected(i)) {
+                    node_flags |= ImGuiTreeNodeFlags_Selected;
+                }
+                ImGui::TreeNodeEx((void*)(intptr_t)(i32)i, node_flags, physics_objects[i].name);
+                if (ImGui::IsItemClicked()) {
+                    Editor::select(i, gui_io.KeyCtrl);
+                }
             }
         }
+        clipper.End();
+        ImGui::EndChild();
         ImGui::TreePop();
     }
 
+    if (len(&Editor::selection) > 1 && ImGui::CollapsingHeader("Selection")) {
+        static f32 batch_mass = 1;
+        static vec2f batch_velocity = {};
+        static vec4f batch_color = {1, 1, 1, 1};
+
+        ImGui::SliderFloat("Batch Mass", &batch_mass, 0, 100);
+        ImGui::SameLine();
+        if (ImGui::Button("Set##mass")) {
+            Editor::for_each_selected([](Physics_Object* obj) { obj->physics_data.mass = batch_mass; });
+        }
+        ImGui::SliderFloat2("Batch Velocity", (f32*)&batch_velocity, -300, 300);
+        if (ImGui::Button("Set##velocity")) {
+            Editor::for_each_selected([](Physics_Object* obj) { obj->physics_data.velocity = batch_velocity; });
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Add##velocity")) {
+            Editor::for_each_selected([](Physics_Object* obj) { obj->physics_data.velocity += batch_velocity; });
+        }
+        if (ImGui::Button("Listen Contacts")) {
+            Editor::for_each_selected([](Physics_Object* obj) { obj->physics_data.contact_events = Contact_Begin | Contact_Stay | Contact_End; });
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Ignore Contacts")) {
+            Editor::for_each_selected([](Physics_Object* obj) { obj->physics_data.contact_events = 0; });
+        }
+        if (ImGui::Button("Make Static")) {
+            Editor::for_each_selected([](Physics_Object* obj) { obj->physics_data.is_static = true; });
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Make Dynamic")) {
+            Editor::for_each_selected([](Physics_Object* obj) { obj->physics_data.is_static = false; });
+        }
+        ImGui::ColorEdit4("Batch Color", (f32*)&batch_color);
+        ImGui::SameLine();
+        if (ImGui::Button("Set##color")) {
+            Editor::for_each_selected([](Physics_Object* obj) { obj->material.color = batch_color; });
+        }
+        if (ImGui::Button("Delete Selected")) {
+            remove_physics_objects(begin(&Editor::selection), len(&Editor::selection));
+        }
+    }
+
     // test();
 
     const f32 abs_max_speed = 300;
@@ -444,7 +1062,9 @@ void draw_gui() {
         }
         if (ImGui::CollapsingHeader("Collider")) {
             i32 item_current = (i32)Editor::selected_object->collider.type;
-            ImGui::Combo("combo 2 (one-liner)", &item_current, "Box Collider2D\0Sphere Collider2D\0\0");
+            if (ImGui::Combo("combo 2 (one-liner)", &item_current, "Box Collider2D\0Sphere Collider2D\0\0")) {
+                Editor::is_filter_dirty = true;
+            }
             Editor::selected_object->collider.type = (Collider_Type)item_current;
 
             if (Editor::selected_object->collider.type == Collider_Type::Box_Collider2D) {
@@ -478,13 +1098,12 @@ void draw_gui() {
                 ImGui::EndCombo();
             }
 
-            sprintf(combo_lable, "%u", mat.texture_name);
-            if (ImGui::BeginCombo("Texture", combo_lable, 0))
+            if (ImGui::BeginCombo("Texture", Assets::texture_names[mat.texture_name], 0))
             {
-                for (u32 n = 0; n < TEXTURE_COUNT; n++)
+                for (u32 n = 0; n < Assets::texture_count; n++)
                 {
-                    const bool is_selected = (mat.shader_name == n);
-                    char name[10]; sprintf(name, "%u", n);
+                    const bool is_selected = (mat.texture_name == n);
+                    const char* name = Assets::texture_names[n];
                     if (ImGui::Selectable(name, is_selected))
                         mat.texture_name = n;
 
@@ -504,11 +1123,21 @@ void draw_gui() {
             Physics_Data& data = Editor::selected_object->physics_data;
             ImGui::SliderFloat("Mass", (f32*)(&data.mass), 0, 100);
             ImGui::SliderFloat2("Velocity", (f32*)(&data.velocity), -abs_max_speed, abs_max_speed);
-            ImGui::Checkbox("Is Static", &data.is_static);
+            if (ImGui::Checkbox("Is Static", &data.is_static)) {
+                Editor::is_filter_dirty = true;
+            }
+            u32 contact_events = data.contact_events;
+            ImGui::Text("Contact Events");
+            ImGui::SameLine();
+            ImGui::CheckboxFlags("Begin", &contact_events, Contact_Begin);
+            ImGui::SameLine();
+            ImGui::CheckboxFlags("Stay", &contact_events, Contact_Stay);
+            ImGui::SameLine();
+            ImGui::CheckboxFlags("End", &contact_events, Contact_End);
+            data.contact_events = (u8)contact_events;
         }
         if (ImGui::Button("Delete")) {
-            remove(&physics_objects, Editor::selected_object);
-            Editor::selected_object = null;
+            remove_physics_object(Editor::selected_index);
         }
     }
 
@@ -531,6 +1160,15 @@ void draw_gui() {
     ImGui::SameLine();
     ImGui::InputText("Load file name", load_file_name_buffer, 100);
 
+    static char import_file_name_buffer[100] = "scene.csv";
+    if (ImGui::Button("Import")) {
+        char s[110] = "Saves/";
+        strcat(s, import_file_name_buffer);
+        import_physics_objects(s);
+    }
+    ImGui::SameLine();
+    ImGui::InputText("Import file name (csv, jsonl)", import_file_name_buffer, 100);
+
     ImGui::End();
 
     ImGui::Begin("Build Menu");
@@ -545,21 +1183,32 @@ void draw_gui() {
                 Builder::selected_object = null;
             }
         }
-        for (u32 i = 0; i < cap(&Builder::objects); i++) {
+        for (u32 i = 0; i < len(&Builder::library.objects); i++) {
             ImGuiTreeNodeFlags node_flags = base_flags;
-            if (&Builder::objects[i] == Builder::selected_object) {
+            if (&Builder::library.objects[i] == Builder::selected_object) {
                 node_flags |= ImGuiTreeNodeFlags_Selected;
             }
-            ImGui::Image((void*)(intptr_t)Assets::textures[Builder::objects[i].material.texture_name].id, ImVec2(30, 30));
+            ImGui::Image((void*)(intptr_t)Assets::textures[Builder::library.objects[i].material.texture_name].id, ImVec2(30, 30));
             ImGui::SameLine();
-            ImGui::TreeNodeEx((void*)(intptr_t)(i32)i, node_flags, Builder::objects[i].name);
+            ImGui::TreeNodeEx((void*)(intptr_t)(i32)i, node_flags, Builder::library.objects[i].name);
             if (ImGui::IsItemClicked()) {
-                Builder::selected_object = &Builder::objects[i];
+                Builder::selected_object = &Builder::library.objects[i];
             }
 
         }
         ImGui::TreePop();
     }
+    if (ImGui::TreeNode("Debris")) {
+        ImGui::SliderInt("Count", &Builder::Debris.count, 1, 100000);
+        ImGui::SliderFloat("Radius", &Builder::Debris.radius, 1, 200);
+        ImGui::SliderFloat("Speed", &Builder::Debris.speed, 0, 200);
+        if (Builder::selected_object == null) {
+            ImGui::Text("select a prefab to spawn");
+        } else if (ImGui::Button("Spawn At Camera")) {
+            Builder::spawn_debris((vec2f)main_camera->transform.position);
+        }
+        ImGui::TreePop();
+    }
     ImGui::End();
 
 }
@@ -0,0 +1,255 @@
+#pragma once
+#include "gpu_graphics/loadings.cc"
+#include "asset_bundle_format.cc"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Assets {
+
+    struct Bundle {
+        u8* data;
+        u64 size;
+        Bundle_Header* header;
+        Bundle_Entry* entries;
+    };
+
+    // names of the loaded textures, index matches Assets::textures
+    char texture_names[TEXTURE_COUNT][BUNDLE_NAME_SIZE];
+    u32 texture_count = 0;
+
+    // the payload has to lie inside the file and a texture has to hold its whole mip chain
+    bool is_entry_valid(Bundle_Entry* e, u64 file_size) {
+        // written this way round so offset + size can't wrap
+        if (e->size > file_size || e->offset > file_size - e->size)
+            return false;
+        if (e->type == Bundle_Entry_Type::Shader)
+            return true;
+        if (e->type != Bundle_Entry_Type::Texture)
+            return false;
+        if (e->width == 0 || e->height == 0 || e->mip_count == 0 || e->mip_count > mip_count_for(e->width, e->height))
+            return false;
+        u64 chain_size = 0;
+        for (u32 level = 0; level < e->mip_count; level++) {
+            chain_size += mip_level_size(e->width, e->height, level);
+        }
+        return e->size >= chain_size;
+    }
+
+    bool open_bundle(Bundle* bundle, const char* file_name) {
+        i32 fd = open(file_name, O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (u64)st.st_size < sizeof(Bundle_Header)) {
+            close(fd);
+            return false;
+        }
+
+        void* data = mmap(null, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+            return false;
+
+        bundle->data = (u8*)data;
+        bundle->size = st.st_size;
+        bundle->header = (Bundle_Header*)data;
+        bundle->entries = (Bundle_Entry*)(bundle->data + sizeof(Bundle_Header));
+
+        Bundle_Header& h = *bundle->header;
+        if (h.magic != BUNDLE_MAGIC || h.version != BUNDLE_VERSION ||
+            sizeof(Bundle_Header) + sizeof(Bundle_Entry) * (u64)h.entry_count > bundle->size)
+        {
+            munmap(bundle->data, bundle->size);
+            return false;
+        }
+        for (u32 i = 0; i < h.entry_count; i++) {
+            if (!is_entry_valid(&bundle->entries[i], bundle->size)) {
+                printf("%s: bad entry %u\n", file_name, i);
+                munmap(bundle->data, bundle->size);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void close_bundle(Bundle* bundle) {
+        munmap(bundle->data, bundle->size);
+        *bundle = {};
+    }
+
+    Bundle_Entry* find_entry(Bundle* bundle, const char* name) {
+        for (u32 i = 0; i < bundle->header->entry_count; i++) {
+            if (strncmp(bundle->entries[i].name, name, BUNDLE_NAME_SIZE) == 0)
+                return &bundle->entries[i];
+        }
+        return null;
+    }
+
+    u32 compile_shader_stage(GLenum stage, const char* src, i32 len) {
+        u32 id = glCreateShader(stage);
+        glShaderSource(id, 1, &src, &len);
+        glCompileShader(id);
+
+        i32 status;
+        glGetShaderiv(id, GL_COMPILE_STATUS, &status);
+        if (status == GL_FALSE) {
+            char log[1024];
+            glGetShaderInfoLog(id, sizeof(log), null, log);
+            printf("shader compilation failed: %s\n", log);
+        }
+        return id;
+    }
+
+    // compiles shader source in the "#shader vertex" / "#shader fragment" format
+    u32 compile_shader_source(const char* src, u64 size) {
+        const char* vertex_tag = "#shader vertex";
+        const char* fragment_tag = "#shader fragment";
+        const char* end = src + size;
+        const char* vs = null; const char* vs_end = null;
+        const char* fs = null; const char* fs_end = null;
+
+        for (const char* it = src; it < end; it++) {
+            if (*it != '#')
+                continue;
+            if ((u64)(end - it) >= strlen(vertex_tag) && strncmp(it, vertex_tag, strlen(vertex_tag)) == 0) {
+                if (fs != null && fs_end == null) fs_end = it;
+                vs = it + strlen(vertex_tag);
+            } else if ((u64)(end - it) >= strlen(fragment_tag) && strncmp(it, fragment_tag, strlen(fragment_tag)) == 0) {
+                if (vs != null && vs_end == null) vs_end = it;
+                fs = it + strlen(fragment_tag);
+            }
+        }
+        if (vs == null || fs == null) {
+            printf("shader source is missing a vertex or fragment section\n");
+            return 0;
+        }
+        if (vs_end == null) vs_end = end;
+        if (fs_end == null) fs_end = end;
+
+        u32 program = glCreateProgram();
+        u32 vs_id = compile_shader_stage(GL_VERTEX_SHADER, vs, vs_end - vs);
+        u32 fs_id = compile_shader_stage(GL_FRAGMENT_SHADER, fs, fs_end - fs);
+        glAttachShader(program, vs_id);
+        glAttachShader(program, fs_id);
+        glLinkProgram(program);
+        glValidateProgram(program);
+        glDeleteShader(vs_id);
+        glDeleteShader(fs_id);
+        return program;
+    }
+
+    u32 upload_texture(Bundle* bundle, Bundle_Entry* e) {
+        u32 id;
+        glGenTextures(1, &id);
+        glBindTexture(GL_TEXTURE_2D, id);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, e->mip_count - 1);
+
+        i32 unpack_alignment;
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpack_alignment);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        u8* pixels = bundle->data + e->offset;
+        for (u32 level = 0; level < e->mip_count; level++) {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, max(e->width >> level, 1u), max(e->height >> level, 1u),
+                0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+            pixels += mip_level_size(e->width, e->height, level);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, unpack_alignment);
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return id;
+    }
+
+    // loads shaders listed in shader_names into Assets::shaders (in that order)
+    // and every texture in the bundle into Assets::textures (in bundle order)
+    bool load_bundle(const char* file_name, const char** shader_names, u32 shader_count) {
+        Bundle bundle;
+        if (!open_bundle(&bundle, file_name))
+            return false;
+
+        for (u32 i = 0; i < shader_count; i++) {
+            Bundle_Entry* e = find_entry(&bundle, shader_names[i]);
+            if (e == null || e->type != Bundle_Entry_Type::Shader) {
+                printf("shader %s is missing from %s\n", shader_names[i], file_name);
+                close_bundle(&bundle);
+                return false;
+            }
+            shaders[i].id = compile_shader_source((const char*)(bundle.data + e->offset), e->size);
+        }
+
+        texture_count = 0;
+        for (u32 i = 0; i < bundle.header->entry_count; i++) {
+            Bundle_Entry* e = &bundle.entries[i];
+            if (e->type != Bundle_Entry_Type::Texture)
+                continue;
+            if (texture_count == TEXTURE_COUNT) {
+                printf("%s has more textures than TEXTURE_COUNT, ignoring the rest\n", file_name);
+                break;
+            }
+            textures[texture_count].id = upload_texture(&bundle, e);
+            memcpy(texture_names[texture_count], e->name, BUNDLE_NAME_SIZE);
+            texture_count++;
+        }
+
+        close_bundle(&bundle);
+        return true;
+    }
+
+    // compiles a shader outside of Assets::shaders, from the bundle when it has one and from file_name otherwise
+    u32 load_shader_program(const char* bundle_file_name, const char* name, const char* file_name) {
+        Bundle bundle;
+        if (open_bundle(&bundle, bundle_file_name)) {
+            Bundle_Entry* e = find_entry(&bundle, name);
+            if (e != null && e->type == Bundle_Entry_Type::Shader) {
+                u32 program = compile_shader_source((const char*)(bundle.data + e->offset), e->size);
+                close_bundle(&bundle);
+                return program;
+            }
+            close_bundle(&bundle);
+        }
+
+        FILE* file = fopen(file_name, "rb");
+        if (file == null) {
+            printf("failed to open %s\n", file_name);
+            return 0;
+        }
+        fseek(file, 0, SEEK_END);
+        u64 size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        char* src = m_alloc<char>(size);
+        fread(src, 1, size, file);
+        fclose(file);
+
+        u32 program = compile_shader_source(src, size);
+        m_free(src);
+        return program;
+    }
+
+    void set_texture_name(u32 index, const char* path) {
+        const char* base = strrchr(path, '/');
+        base = (base == null ? path : base + 1);
+        const char* dot = strrchr(base, '.');
+        u32 len = (dot == null ? strlen(base) : (u32)(dot - base));
+        len = min(len, BUNDLE_NAME_SIZE - 1);
+        memset(texture_names[index], 0, BUNDLE_NAME_SIZE);
+        memcpy(texture_names[index], base, len);
+    }
+
+    // index into Assets::textures by name, 0 if there is no such texture
+    u32 find_texture(const char* name) {
+        for (u32 i = 0; i < texture_count; i++) {
+            if (strncmp(texture_names[i], name, BUNDLE_NAME_SIZE) == 0)
+                return i;
+        }
+        printf("texture %s not found\n", name);
+        return 0;
+    }
+}
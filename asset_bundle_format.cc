@@ -0,0 +1,54 @@
+#pragma once
+#include "cp_lib/basic.cc"
+
+// On-disk layout of the packed asset bundle, shared by the offline packer
+// (pack_assets.cc) and the runtime loader (asset_bundle.cc).
+//
+// [Bundle_Header][Bundle_Entry * entry_count][payloads...]
+//
+// Shader payload  - raw glsl text in the "#shader vertex/fragment" format.
+// Texture payload - RGBA8 pixels, mip levels stored one after another
+//                   starting from level 0, ready for glTexImage2D.
+
+namespace Assets {
+
+    const u32 BUNDLE_MAGIC = 0x444e4241; // "ABND"
+    const u32 BUNDLE_VERSION = 1;
+    const u32 BUNDLE_NAME_SIZE = 64;
+    const u32 BUNDLE_ALIGNMENT = 16;
+
+    enum struct Bundle_Entry_Type : u32 {
+        Shader, Texture
+    };
+
+    struct Bundle_Header {
+        u32 magic;
+        u32 version;
+        u32 entry_count;
+        u32 reserved;
+    };
+
+    struct Bundle_Entry {
+        char name[BUNDLE_NAME_SIZE];
+        Bundle_Entry_Type type;
+        u32 width;
+        u32 height;
+        u32 mip_count;
+        u64 offset;
+        u64 size;
+    };
+
+    u64 mip_level_size(u32 width, u32 height, u32 level) {
+        u32 w = max(width >> level, 1u);
+        u32 h = max(height >> level, 1u);
+        return (u64)w * h * 4;
+    }
+
+    u32 mip_count_for(u32 width, u32 height) {
+        u32 count = 1;
+        while ((width >> count) > 0 || (height >> count) > 0) {
+            count++;
+        }
+        return count;
+    }
+}
@@ -0,0 +1,340 @@
+#pragma once
+#include "physics.cc"
+#include "particles.cc"
+
+#include <math.h>
+#include <string.h>
+
+// State hashing and a side by side determinism check, to prove that an
+// optimisation of the step (threads, reordering, vectorisation) didn't change
+// its results.
+
+inline u64 hash_words(u64 h, const void* data, u32 size) {
+    const u8* bytes = (const u8*)data;
+    for (u32 i = 0; i + 4 <= size; i += 4) {
+        u32 w;
+        memcpy(&w, bytes + i, 4);
+        h = (h ^ w) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+// only the simulated fields, padding and pointers (name) would make equal states hash differently
+u64 hash_physics_object(u64 h, Physics_Object* obj) {
+    h = hash_words(h, &obj->transform.position, sizeof(obj->transform.position));
+    h = hash_words(h, &obj->transform.rotation, sizeof(obj->transform.rotation));
+    h = hash_words(h, &obj->transform.scale, sizeof(obj->transform.scale));
+    h = hash_words(h, &obj->physics_data.mass, sizeof(obj->physics_data.mass));
+    h = hash_words(h, &obj->physics_data.velocity, sizeof(obj->physics_data.velocity));
+    u32 is_static = obj->physics_data.is_static;
+    h = hash_words(h, &is_static, sizeof(is_static));
+    u32 type = (u32)obj->collider.type;
+    h = hash_words(h, &type, sizeof(type));
+    if (obj->collider.type == Collider_Type::Box_Collider2D) {
+        h = hash_words(h, &obj->collider.box_collider2d, sizeof(Box_Collider2D));
+    } else {
+        h = hash_words(h, &obj->collider.sphere_collider2d, sizeof(Sphere_Collider2D));
+    }
+    return h;
+}
+
+const u64 state_hash_seed = 0xcbf29ce484222325ull;
+
+u64 hash_physics_state() {
+    u64 h = state_hash_seed;
+    for (auto it = begin(&physics_objects); it != end(&physics_objects); it++) {
+        h = hash_physics_object(h, it);
+    }
+    return h;
+}
+
+u64 hash_particle_state(Particle_System* ps) {
+    u64 h = state_hash_seed;
+    h = hash_words(h, ps->pos_x, sizeof(f32) * ps->count);
+    h = hash_words(h, ps->pos_y, sizeof(f32) * ps->count);
+    h = hash_words(h, ps->vel_x, sizeof(f32) * ps->count);
+    h = hash_words(h, ps->vel_y, sizeof(f32) * ps->count);
+    return h;
+}
+
+// opt-in per step hash log, keeps the last capacity steps
+struct {
+    bool is_enabled = false;
+    // 100 s at 360 Hz
+    u32 capacity = 36000;
+    // step s is at hashes[s % capacity] once the log is full
+    darr<u64> hashes;
+    u64 step_count = 0;
+} State_Hash_Log;
+
+void record_state_hash() {
+    if (!State_Hash_Log.is_enabled)
+        return;
+    if (State_Hash_Log.hashes.buffer == null) {
+        init(&State_Hash_Log.hashes, State_Hash_Log.capacity);
+    }
+    u64 h = hash_physics_state();
+    if (len(&State_Hash_Log.hashes) < State_Hash_Log.capacity) {
+        dpush(&State_Hash_Log.hashes, h);
+    } else {
+        State_Hash_Log.hashes[State_Hash_Log.step_count % State_Hash_Log.capacity] = h;
+    }
+    State_Hash_Log.step_count++;
+}
+
+u64 last_state_hash() {
+    if (State_Hash_Log.step_count == 0)
+        return 0;
+    return State_Hash_Log.hashes[(State_Hash_Log.step_count - 1) % State_Hash_Log.capacity];
+}
+
+void clear_state_hash_log() {
+    State_Hash_Log.hashes.len = 0;
+    State_Hash_Log.step_count = 0;
+}
+
+// oldest step first, lines are "<step> <hash>"
+bool save_state_hash_log(const char* file_name) {
+    FILE* file = fopen(file_name, "w");
+    if (file == null)
+        return false;
+    u64 first = State_Hash_Log.step_count - len(&State_Hash_Log.hashes);
+    for (u64 s = first; s < State_Hash_Log.step_count; s++) {
+        fprintf(file, "%llu %016llx\n", (unsigned long long)s,
+            (unsigned long long)State_Hash_Log.hashes[s % State_Hash_Log.capacity]);
+    }
+    fclose(file);
+    return true;
+}
+
+
+struct Determinism_Config {
+    bool is_morton_sorted = false;
+    u32 morton_interval = 16;
+    u32 particle_thread_count = 1;
+};
+
+struct Determinism_Report {
+    bool is_diverged;
+    bool is_particle;
+    u32 step;
+    // index in the starting scene (bodies) or in spawn order (particles, Particle_System::id)
+    u32 index;
+    f32 error;
+    u32 steps_run;
+};
+
+struct Determinism_World {
+    Determinism_Config config;
+    darr<Physics_Object> objects;
+    // ids[i] is the starting index of the body now at i, follows morton sorts
+    darr<u32> ids;
+    darr<u32> index_of_id;
+    Particle_System particles;
+    // particle_index_of_id[id] is where the particle spawned as id sits now
+    darr<u32> particle_index_of_id;
+    Contact_State contacts;
+    u32 steps_since_sort;
+};
+
+Determinism_World* determinism_active_world = null;
+
+void on_determinism_world_remap(const u32* remap, u32 old_len) {
+    darr<u32>& ids = determinism_active_world->ids;
+    darr<u32>& tmp = determinism_active_world->index_of_id;
+    for (u32 i = 0; i < old_len; i++) {
+        tmp[remap[i]] = ids[i];
+    }
+    memcpy(begin(&ids), begin(&tmp), sizeof(u32) * old_len);
+}
+
+void init(Determinism_World* world, Determinism_Config config) {
+    *world = {};
+    world->config = config;
+
+    u32 count = len(&physics_objects);
+    init(&world->objects, max(count, 1u));
+    world->objects.len = count;
+    memcpy(begin(&world->objects), begin(&physics_objects), sizeof(Physics_Object) * count);
+
+    init(&world->ids, max(count, 1u));
+    init(&world->index_of_id, max(count, 1u));
+    world->ids.len = count;
+    world->index_of_id.len = count;
+    for (u32 i = 0; i < count; i++) {
+        world->ids[i] = i;
+    }
+
+    init(&world->particles, max(particle_system.count, 1u));
+    world->particles.params = particle_system.params;
+    world->particles.thread_count = config.particle_thread_count;
+    init(&world->contacts);
+    world->particles.count = particle_system.count;
+    memcpy(world->particles.pos_x, particle_system.pos_x, sizeof(f32) * particle_system.count);
+    memcpy(world->particles.pos_y, particle_system.pos_y, sizeof(f32) * particle_system.count);
+    memcpy(world->particles.vel_x, particle_system.vel_x, sizeof(f32) * particle_system.count);
+    memcpy(world->particles.vel_y, particle_system.vel_y, sizeof(f32) * particle_system.count);
+    memcpy(world->particles.id, particle_system.id, sizeof(u32) * particle_system.count);
+    init(&world->particle_index_of_id, max(particle_system.count, 1u));
+    world->particle_index_of_id.len = particle_system.count;
+}
+
+void shut(Determinism_World* world) {
+    shut(&world->objects);
+    shut(&world->ids);
+    shut(&world->index_of_id);
+    shut(&world->particles);
+    shut(&world->particle_index_of_id);
+    shut(&world->contacts);
+}
+
+void step(Determinism_World* world) {
+    std::swap(physics_objects, world->objects);
+    std::swap(contacts, world->contacts);
+    determinism_active_world = world;
+
+    bool was_morton_sorted = Morton_Sort.is_enabled;
+    u32 morton_interval = Morton_Sort.interval;
+    u32 steps_since_sort = Morton_Sort.steps_since_sort;
+    Morton_Sort.is_enabled = world->config.is_morton_sorted;
+    Morton_Sort.interval = world->config.morton_interval;
+    Morton_Sort.steps_since_sort = world->steps_since_sort;
+    // both worlds run every body every tick, the live lod state is set aside so
+    // physics_update neither catches it up on the copies nor resets it
+    Sim_Lod_Type live_lod;
+    stash_sim_lod(&live_lod);
+    Sim_Lod.is_enabled = false;
+
+    physics_update();
+    particles_step(&world->particles, world->particles.params.fixed_dt);
+
+    world->steps_since_sort = Morton_Sort.steps_since_sort;
+    unstash_sim_lod(&live_lod);
+    Morton_Sort.is_enabled = was_morton_sorted;
+    Morton_Sort.interval = morton_interval;
+    Morton_Sort.steps_since_sort = steps_since_sort;
+
+    determinism_active_world = null;
+    std::swap(contacts, world->contacts);
+    std::swap(physics_objects, world->objects);
+
+    for (u32 i = 0; i < len(&world->ids); i++) {
+        world->index_of_id[world->ids[i]] = i;
+    }
+    // the cell sort reorders particles every step, ids are the spawn order
+    for (u32 i = 0; i < world->particles.count; i++) {
+        world->particle_index_of_id[world->particles.id[i]] = i;
+    }
+}
+
+// bodies hashed in starting order, so worlds that reorder differently still compare
+u64 hash_physics_state_of(Determinism_World* world) {
+    u64 h = state_hash_seed;
+    for (u32 id = 0; id < len(&world->ids); id++) {
+        h = hash_physics_object(h, &world->objects[world->index_of_id[id]]);
+    }
+    return h;
+}
+
+// largest absolute difference of the simulated fields, infinity if the discrete ones differ
+f32 state_error(Physics_Object* a, Physics_Object* b) {
+    if (a->physics_data.is_static != b->physics_data.is_static || a->collider.type != b->collider.type)
+        return INFINITY;
+
+    f32 error = 0;
+    const f32* fa[] = { (f32*)&a->transform.position, (f32*)&a->transform.rotation, (f32*)&a->physics_data.velocity };
+    const f32* fb[] = { (f32*)&b->transform.position, (f32*)&b->transform.rotation, (f32*)&b->physics_data.velocity };
+    u32 counts[] = { 3, 4, 2 };
+    for (u32 k = 0; k < 3; k++) {
+        for (u32 i = 0; i < counts[k]; i++) {
+            f32 d = fabsf(fa[k][i] - fb[k][i]);
+            // NaN on either side counts as a divergence
+            error = (d == d ? max(error, d) : INFINITY);
+        }
+    }
+    return error;
+}
+
+// tolerance == 0 asks for bit exact results
+bool find_divergence(Determinism_World* a, Determinism_World* b, f32 tolerance, Determinism_Report* report) {
+    u32 count = len(&a->ids);
+    for (u32 id = 0; id < count; id++) {
+        Physics_Object* obj_a = &a->objects[a->index_of_id[id]];
+        Physics_Object* obj_b = &b->objects[b->index_of_id[id]];
+        if (tolerance == 0) {
+            if (hash_physics_object(state_hash_seed, obj_a) == hash_physics_object(state_hash_seed, obj_b))
+                continue;
+            report->error = state_error(obj_a, obj_b);
+        } else {
+            f32 error = state_error(obj_a, obj_b);
+            if (error <= tolerance)
+                continue;
+            report->error = error;
+        }
+        report->is_particle = false;
+        report->index = id;
+        return true;
+    }
+
+    Particle_System* pa = &a->particles;
+    Particle_System* pb = &b->particles;
+    for (u32 id = 0; id < pa->count; id++) {
+        u32 i = a->particle_index_of_id[id];
+        u32 j = b->particle_index_of_id[id];
+        f32 error = max(max(fabsf(pa->pos_x[i] - pb->pos_x[j]), fabsf(pa->pos_y[i] - pb->pos_y[j])),
+            max(fabsf(pa->vel_x[i] - pb->vel_x[j]), fabsf(pa->vel_y[i] - pb->vel_y[j])));
+        bool is_equal = (tolerance == 0 ?
+            pa->pos_x[i] == pb->pos_x[j] && pa->pos_y[i] == pb->pos_y[j] && pa->vel_x[i] == pb->vel_x[j] && pa->vel_y[i] == pb->vel_y[j] :
+            error <= tolerance);
+        if (is_equal)
+            continue;
+        report->is_particle = true;
+        report->index = id;
+        report->error = (error == error ? error : INFINITY);
+        return true;
+    }
+    return false;
+}
+
+// runs the current scene under two configurations in lockstep, the live scene is not touched
+Determinism_Report check_determinism(Determinism_Config config_a, Determinism_Config config_b, u32 step_count, f32 tolerance) {
+    Determinism_Report report = {};
+
+    // listeners of the live scene must not see the reordering of the copies
+    darr<Physics_Remap_Fn> live_listeners = physics_remap_listeners;
+    physics_remap_listeners = {};
+    add_physics_remap_listener(on_determinism_world_remap);
+    add_physics_remap_listener(on_contacts_remap);
+
+    Determinism_World a, b;
+    init(&a, config_a);
+    init(&b, config_b);
+
+    for (u32 s = 0; s < step_count; s++) {
+        step(&a);
+        step(&b);
+        report.steps_run = s + 1;
+
+        if (tolerance == 0 && hash_physics_state_of(&a) == hash_physics_state_of(&b) &&
+            hash_particle_state(&a.particles) == hash_particle_state(&b.particles))
+            continue;
+        if (find_divergence(&a, &b, tolerance, &report)) {
+            report.is_diverged = true;
+            report.step = s;
+            break;
+        }
+    }
+
+    shut(&a);
+    shut(&b);
+    shut(&physics_remap_listeners);
+    physics_remap_listeners = live_listeners;
+
+    if (report.is_diverged) {
+        printf("determinism check: diverged at step %u, %s %u, error %g\n", report.step,
+            report.is_particle ? "particle" : "body", report.index, report.error);
+    } else {
+        printf("determinism check: %u steps match (%s)\n", report.steps_run, tolerance == 0 ? "bit exact" : "within tolerance");
+    }
+    return report;
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include "cp_lib/basic.cc"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Persistent worker pool for data-parallel loops. The calling thread takes part
+// in every loop, so parallel_for with thread_count == 1 runs inline.
+namespace Jobs {
+
+    typedef void(*Range_Fn)(void* ctx, u32 begin, u32 end);
+
+    struct {
+        std::thread* workers = null;
+        u32 worker_count = 0;
+
+        std::mutex mutex;
+        std::condition_variable wake_cv;
+        std::condition_variable done_cv;
+        u64 generation = 0;
+        bool is_quitting = false;
+
+        Range_Fn fn;
+        void* ctx;
+        u32 count;
+        u32 chunk_size;
+        u32 active_workers;
+        u32 busy_workers;
+        std::atomic<u32> next_chunk;
+    } pool;
+
+    u32 max_thread_count() {
+        return pool.worker_count + 1;
+    }
+
+    void run_chunks() {
+        for (;;) {
+            u32 begin = pool.next_chunk.fetch_add(1) * pool.chunk_size;
+            if (begin >= pool.count)
+                break;
+            pool.fn(pool.ctx, begin, min(begin + pool.chunk_size, pool.count));
+        }
+    }
+
+    void worker_loop(u32 index) {
+        u64 seen_generation = 0;
+        for (;;) {
+            std::unique_lock<std::mutex> lock(pool.mutex);
+            pool.wake_cv.wait(lock, [&] { return pool.is_quitting || pool.generation != seen_generation; });
+            if (pool.is_quitting)
+                return;
+            seen_generation = pool.generation;
+            if (index >= pool.active_workers)
+                continue;
+
+            lock.unlock();
+            run_chunks();
+            lock.lock();
+
+            pool.busy_workers--;
+            if (pool.busy_workers == 0)
+                pool.done_cv.notify_one();
+        }
+    }
+
+    // worker_count = 0 picks one worker per hardware thread minus the caller
+    void init(u32 worker_count = 0) {
+        if (worker_count == 0) {
+            u32 hw = std::thread::hardware_concurrency();
+            worker_count = (hw > 1 ? hw - 1 : 0);
+        }
+
+        pool.is_quitting = false;
+        pool.worker_count = worker_count;
+        pool.workers = new std::thread[worker_count];
+        for (u32 i = 0; i < worker_count; i++) {
+            pool.workers[i] = std::thread(worker_loop, i);
+        }
+    }
+
+    void shut() {
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            pool.is_quitting = true;
+        }
+        pool.wake_cv.notify_all();
+        for (u32 i = 0; i < pool.worker_count; i++) {
+            pool.workers[i].join();
+        }
+        delete[] pool.workers;
+        pool.workers = null;
+        pool.worker_count = 0;
+    }
+
+    // calls fn(ctx, begin, end) over [0, count) split in chunks, using at most thread_count threads
+    void run_parallel(u32 count, u32 thread_count, Range_Fn fn, void* ctx) {
+        if (count == 0)
+            return;
+        if (thread_count <= 1 || pool.worker_count == 0) {
+            fn(ctx, 0, count);
+            return;
+        }
+        u32 active_workers = min(thread_count, max_thread_count()) - 1;
+
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            pool.fn = fn;
+            pool.ctx = ctx;
+            pool.count = count;
+            pool.chunk_size = max(count / ((active_workers + 1) * 8), 64u);
+            pool.active_workers = active_workers;
+            pool.busy_workers = active_workers;
+            pool.next_chunk = 0;
+            pool.generation++;
+        }
+        pool.wake_cv.notify_all();
+
+        run_chunks();
+
+        std::unique_lock<std::mutex> lock(pool.mutex);
+        pool.done_cv.wait(lock, [] { return pool.busy_workers == 0; });
+    }
+
+    template <typename F>
+    void parallel_for(u32 count, u32 thread_count, F f) {
+        run_parallel(count, thread_count, [](void* ctx, u32 begin, u32 end) { (*(F*)ctx)(begin, end); }, &f);
+    }
+}
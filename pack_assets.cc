@@ -0,0 +1,199 @@
+// Offline asset packer.
+//
+// Bakes shaders and pre-decoded textures (with a full box-filtered mip chain)
+// into one bundle that the game maps at startup instead of decoding PNGs.
+//
+// usage: pack_assets <out.bundle> <file.glsl|file.png>...
+//
+// Entries are named by file name without directory and extension
+// ("Assets/Textures/BoxCollider2D.png" -> "BoxCollider2D"). Textures keep the
+// order they are given on the command line, which is the order they end up in
+// Assets::textures, so saved materials keep pointing at the same texture.
+//
+// Build: g++ -O2 pack_assets.cc -o pack_assets
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "gpu_graphics/import/stb_image.h"
+
+#include "asset_bundle_format.cc"
+
+using namespace Assets;
+
+struct Pack_Item {
+    Bundle_Entry entry;
+    u8* data;
+};
+
+bool has_extension(const char* path, const char* ext) {
+    size_t path_len = strlen(path);
+    size_t ext_len = strlen(ext);
+    return path_len >= ext_len && strcmp(path + path_len - ext_len, ext) == 0;
+}
+
+void entry_name_from_path(char* out, const char* path) {
+    const char* base = strrchr(path, '/');
+    base = (base == null ? path : base + 1);
+    const char* dot = strrchr(base, '.');
+    size_t len = (dot == null ? strlen(base) : (size_t)(dot - base));
+    if (len >= BUNDLE_NAME_SIZE)
+        len = BUNDLE_NAME_SIZE - 1;
+    memset(out, 0, BUNDLE_NAME_SIZE);
+    memcpy(out, base, len);
+}
+
+u8* read_file(const char* path, u64* out_size) {
+    FILE* file = fopen(path, "rb");
+    if (file == null)
+        return null;
+
+    fseek(file, 0, SEEK_END);
+    u64 size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    u8* data = (u8*)malloc(size);
+    fread(data, 1, size, file);
+    fclose(file);
+
+    *out_size = size;
+    return data;
+}
+
+// 2x2 box filter, odd edges clamp to the last texel
+void downsample(u8* dst, const u8* src, u32 src_w, u32 src_h) {
+    u32 dst_w = max(src_w / 2, 1u);
+    u32 dst_h = max(src_h / 2, 1u);
+    for (u32 y = 0; y < dst_h; y++) {
+        u32 y0 = min(y * 2, src_h - 1);
+        u32 y1 = min(y * 2 + 1, src_h - 1);
+        for (u32 x = 0; x < dst_w; x++) {
+            u32 x0 = min(x * 2, src_w - 1);
+            u32 x1 = min(x * 2 + 1, src_w - 1);
+            for (u32 c = 0; c < 4; c++) {
+                u32 sum = src[(y0 * src_w + x0) * 4 + c] + src[(y0 * src_w + x1) * 4 + c] +
+                    src[(y1 * src_w + x0) * 4 + c] + src[(y1 * src_w + x1) * 4 + c];
+                dst[(y * dst_w + x) * 4 + c] = (u8)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+bool pack_texture(Pack_Item* item, const char* path) {
+    i32 w, h, channels;
+    // flipped so that row 0 is the bottom one, as glTexImage2D expects
+    stbi_set_flip_vertically_on_load(1);
+    u8* pixels = stbi_load(path, &w, &h, &channels, 4);
+    if (pixels == null) {
+        fprintf(stderr, "failed to decode %s: %s\n", path, stbi_failure_reason());
+        return false;
+    }
+
+    Bundle_Entry& e = item->entry;
+    e.type = Bundle_Entry_Type::Texture;
+    e.width = w;
+    e.height = h;
+    e.mip_count = mip_count_for(w, h);
+    e.size = 0;
+    for (u32 level = 0; level < e.mip_count; level++) {
+        e.size += mip_level_size(w, h, level);
+    }
+
+    item->data = (u8*)malloc(e.size);
+    memcpy(item->data, pixels, mip_level_size(w, h, 0));
+    stbi_image_free(pixels);
+
+    u8* src = item->data;
+    for (u32 level = 1; level < e.mip_count; level++) {
+        u8* dst = src + mip_level_size(w, h, level - 1);
+        downsample(dst, src, max((u32)w >> (level - 1), 1u), max((u32)h >> (level - 1), 1u));
+        src = dst;
+    }
+    return true;
+}
+
+bool pack_shader(Pack_Item* item, const char* path) {
+    u64 size;
+    item->data = read_file(path, &size);
+    if (item->data == null) {
+        fprintf(stderr, "failed to read %s\n", path);
+        return false;
+    }
+
+    Bundle_Entry& e = item->entry;
+    e.type = Bundle_Entry_Type::Shader;
+    e.width = 0;
+    e.height = 0;
+    e.mip_count = 0;
+    e.size = size;
+    return true;
+}
+
+u64 align_up(u64 value, u64 alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <out.bundle> <file.glsl|file.png>...\n", argv[0]);
+        return 1;
+    }
+
+    u32 item_count = argc - 2;
+    Pack_Item* items = (Pack_Item*)calloc(item_count, sizeof(Pack_Item));
+
+    for (u32 i = 0; i < item_count; i++) {
+        const char* path = argv[i + 2];
+        entry_name_from_path(items[i].entry.name, path);
+
+        bool ok;
+        if (has_extension(path, ".glsl")) {
+            ok = pack_shader(&items[i], path);
+        } else if (has_extension(path, ".png")) {
+            ok = pack_texture(&items[i], path);
+        } else {
+            fprintf(stderr, "unsupported asset type: %s\n", path);
+            ok = false;
+        }
+        if (!ok)
+            return 1;
+    }
+
+    u64 offset = align_up(sizeof(Bundle_Header) + sizeof(Bundle_Entry) * item_count, BUNDLE_ALIGNMENT);
+    for (u32 i = 0; i < item_count; i++) {
+        items[i].entry.offset = offset;
+        offset = align_up(offset + items[i].entry.size, BUNDLE_ALIGNMENT);
+    }
+
+    FILE* file = fopen(argv[1], "wb");
+    if (file == null) {
+        fprintf(stderr, "failed to open %s for writing\n", argv[1]);
+        return 1;
+    }
+
+    Bundle_Header header = { BUNDLE_MAGIC, BUNDLE_VERSION, item_count, 0 };
+    fwrite(&header, sizeof(Bundle_Header), 1, file);
+    for (u32 i = 0; i < item_count; i++) {
+        fwrite(&items[i].entry, sizeof(Bundle_Entry), 1, file);
+    }
+
+    const u8 zeros[BUNDLE_ALIGNMENT] = {};
+    for (u32 i = 0; i < item_count; i++) {
+        u64 pos = ftell(file);
+        fwrite(zeros, 1, items[i].entry.offset - pos, file);
+        fwrite(items[i].data, 1, items[i].entry.size, file);
+        free(items[i].data);
+
+        Bundle_Entry& e = items[i].entry;
+        if (e.type == Bundle_Entry_Type::Texture) {
+            printf("%-24s texture %ux%u, %u mips, %llu bytes\n", e.name, e.width, e.height, e.mip_count, (unsigned long long)e.size);
+        } else {
+            printf("%-24s shader %llu bytes\n", e.name, (unsigned long long)e.size);
+        }
+    }
+    fclose(file);
+    free(items);
+
+    return 0;
+}
@@ -0,0 +1,459 @@
+#pragma once
+#include "physics.cc"
+#include "jobs.cc"
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <utility>
+
+// SPH particle fluid, kept apart from Physics_Object so a particle costs a few
+// floats instead of a whole body. Particles are stored as SoA arrays and are
+// re-sorted by neighbor grid cell every step, so neighbors sit next to each
+// other in memory. Rigid bodies act as one-way boundaries.
+
+struct Particle_Params {
+    f32 smoothing_radius = 0.1f;
+    f32 particle_mass = 2.5f;
+    f32 rest_density = 1000;
+    f32 stiffness = 400;
+    f32 viscosity = 2;
+    f32 restitution = 0.3f;
+    f32 friction = 0.1f;
+    vec2f gravity = {0, -9.8f};
+    f32 fixed_dt = 1.0f / 240;
+    u32 max_substeps = 4;
+};
+
+struct Particle_System {
+    u32 count;
+    u32 cap;
+
+    f32* pos_x;
+    f32* pos_y;
+    f32* vel_x;
+    f32* vel_y;
+    f32* density;
+    f32* pressure;
+    // spawn order, follows the particle through the cell sort
+    u32* id;
+
+    // scratch arrays, swapped with the ones above by the cell sort and the force pass
+    f32* tmp_pos_x;
+    f32* tmp_pos_y;
+    f32* tmp_vel_x;
+    f32* tmp_vel_y;
+    u32* tmp_id;
+
+    // hashed cell-linked grid, particles of bucket b are [cell_start[b], cell_start[b + 1])
+    u32* cell_of;
+    u32* cell_start;
+    u32* cell_cursor;
+    u32 bucket_count;
+
+    Particle_Params params;
+    u32 thread_count;
+    f32 accumulated_dt;
+    f32 last_step_ms;
+};
+
+Particle_System particle_system;
+
+struct Particle_Boundary {
+    Collider collider;
+    vec2f velocity;
+};
+
+darr<Particle_Boundary> particle_boundaries;
+
+void init(Particle_System* ps, u32 cap) {
+    *ps = {};
+    ps->params = Particle_Params();
+    ps->thread_count = Jobs::max_thread_count();
+
+    ps->cap = cap;
+    ps->pos_x = m_ralloc(ps->pos_x, cap);
+    ps->pos_y = m_ralloc(ps->pos_y, cap);
+    ps->vel_x = m_ralloc(ps->vel_x, cap);
+    ps->vel_y = m_ralloc(ps->vel_y, cap);
+    ps->density = m_ralloc(ps->density, cap);
+    ps->pressure = m_ralloc(ps->pressure, cap);
+    ps->id = m_ralloc(ps->id, cap);
+    ps->tmp_pos_x = m_ralloc(ps->tmp_pos_x, cap);
+    ps->tmp_pos_y = m_ralloc(ps->tmp_pos_y, cap);
+    ps->tmp_vel_x = m_ralloc(ps->tmp_vel_x, cap);
+    ps->tmp_vel_y = m_ralloc(ps->tmp_vel_y, cap);
+    ps->tmp_id = m_ralloc(ps->tmp_id, cap);
+    ps->cell_of = m_ralloc(ps->cell_of, cap);
+
+    // power of two bucket count, about two buckets per particle
+    ps->bucket_count = 1;
+    while (ps->bucket_count < cap * 2) {
+        ps->bucket_count <<= 1;
+    }
+    ps->cell_start = m_ralloc(ps->cell_start, ps->bucket_count + 1);
+    ps->cell_cursor = m_ralloc(ps->cell_cursor, ps->bucket_count);
+}
+
+void shut(Particle_System* ps) {
+    m_free(ps->pos_x); m_free(ps->pos_y); m_free(ps->vel_x); m_free(ps->vel_y);
+    m_free(ps->density); m_free(ps->pressure); m_free(ps->id);
+    m_free(ps->tmp_pos_x); m_free(ps->tmp_pos_y); m_free(ps->tmp_vel_x); m_free(ps->tmp_vel_y); m_free(ps->tmp_id);
+    m_free(ps->cell_of); m_free(ps->cell_start); m_free(ps->cell_cursor);
+    *ps = {};
+}
+
+void reserve(Particle_System* ps, u32 cap) {
+    if (cap <= ps->cap)
+        return;
+
+    Particle_System old = *ps;
+    init(ps, cap);
+    ps->params = old.params;
+    ps->thread_count = old.thread_count;
+    ps->accumulated_dt = old.accumulated_dt;
+    ps->count = old.count;
+    memcpy(ps->pos_x, old.pos_x, sizeof(f32) * old.count);
+    memcpy(ps->pos_y, old.pos_y, sizeof(f32) * old.count);
+    memcpy(ps->vel_x, old.vel_x, sizeof(f32) * old.count);
+    memcpy(ps->vel_y, old.vel_y, sizeof(f32) * old.count);
+    memcpy(ps->id, old.id, sizeof(u32) * old.count);
+    shut(&old);
+}
+
+void clear(Particle_System* ps) {
+    ps->count = 0;
+    ps->accumulated_dt = 0;
+}
+
+void spawn_particle_block(Particle_System* ps, vec2f lb, vec2f rt, f32 spacing) {
+    u32 nx = (u32)((rt.x - lb.x) / spacing);
+    u32 ny = (u32)((rt.y - lb.y) / spacing);
+    u32 new_count = ps->count + nx * ny;
+    if (new_count > ps->cap) {
+        reserve(ps, max(new_count, ps->cap * 2));
+    }
+
+    u32 i = ps->count;
+    for (u32 y = 0; y < ny; y++) {
+        for (u32 x = 0; x < nx; x++, i++) {
+            // alternate rows are shifted, a square lattice is an unstable equilibrium
+            ps->pos_x[i] = lb.x + (x + (y & 1) * 0.5f) * spacing;
+            ps->pos_y[i] = lb.y + y * spacing;
+            ps->vel_x[i] = 0;
+            ps->vel_y[i] = 0;
+            ps->id[i] = i;
+        }
+    }
+    ps->count = new_count;
+}
+
+inline i32 particle_cell_coord(f32 p, f32 cell_size) {
+    return (i32)floorf(p / cell_size);
+}
+
+inline u32 particle_cell_bucket(i32 cx, i32 cy, u32 bucket_count) {
+    return ((u32)cx * 73856093u ^ (u32)cy * 19349663u) & (bucket_count - 1);
+}
+
+// calls f(j) for every particle in the 3x3 cells around (x, y); buckets that
+// several of those cells hash into are visited once
+template <typename F>
+inline void for_each_neighbor(Particle_System* ps, f32 x, f32 y, F f) {
+    f32 h = ps->params.smoothing_radius;
+    i32 cx = particle_cell_coord(x, h);
+    i32 cy = particle_cell_coord(y, h);
+
+    u32 visited[9];
+    u32 visited_count = 0;
+    for (i32 dy = -1; dy <= 1; dy++) {
+        for (i32 dx = -1; dx <= 1; dx++) {
+            u32 b = particle_cell_bucket(cx + dx, cy + dy, ps->bucket_count);
+            bool is_visited = false;
+            for (u32 k = 0; k < visited_count; k++) {
+                if (visited[k] == b) { is_visited = true; break; }
+            }
+            if (is_visited)
+                continue;
+            visited[visited_count++] = b;
+
+            for (u32 j = ps->cell_start[b]; j < ps->cell_start[b + 1]; j++) {
+                f(j);
+            }
+        }
+    }
+}
+
+// counting sort of particles by grid bucket, stable inside a bucket
+void sort_particles_by_cell(Particle_System* ps) {
+    f32 h = ps->params.smoothing_radius;
+    Jobs::parallel_for(ps->count, ps->thread_count, [=](u32 begin, u32 end) {
+        for (u32 i = begin; i < end; i++) {
+            ps->cell_of[i] = particle_cell_bucket(particle_cell_coord(ps->pos_x[i], h),
+                particle_cell_coord(ps->pos_y[i], h), ps->bucket_count);
+        }
+    });
+
+    memset(ps->cell_start, 0, sizeof(u32) * (ps->bucket_count + 1));
+    for (u32 i = 0; i < ps->count; i++) {
+        ps->cell_start[ps->cell_of[i] + 1]++;
+    }
+    for (u32 b = 0; b < ps->bucket_count; b++) {
+        ps->cell_start[b + 1] += ps->cell_start[b];
+    }
+
+    memcpy(ps->cell_cursor, ps->cell_start, sizeof(u32) * ps->bucket_count);
+    for (u32 i = 0; i < ps->count; i++) {
+        u32 dst = ps->cell_cursor[ps->cell_of[i]]++;
+        ps->tmp_pos_x[dst] = ps->pos_x[i];
+        ps->tmp_pos_y[dst] = ps->pos_y[i];
+        ps->tmp_vel_x[dst] = ps->vel_x[i];
+        ps->tmp_vel_y[dst] = ps->vel_y[i];
+        ps->tmp_id[dst] = ps->id[i];
+    }
+
+    std::swap(ps->pos_x, ps->tmp_pos_x);
+    std::swap(ps->pos_y, ps->tmp_pos_y);
+    std::swap(ps->vel_x, ps->tmp_vel_x);
+    std::swap(ps->vel_y, ps->tmp_vel_y);
+    std::swap(ps->id, ps->tmp_id);
+}
+
+// colliders whose bounds overlap the particles, with their surface velocity
+void gather_particle_boundaries(Particle_System* ps) {
+    if (ps->count == 0)
+        return;
+
+    vec2f lb = { ps->pos_x[0], ps->pos_y[0] };
+    vec2f rt = lb;
+    for (u32 i = 1; i < ps->count; i++) {
+        lb = { min(lb.x, ps->pos_x[i]), min(lb.y, ps->pos_y[i]) };
+        rt = { max(rt.x, ps->pos_x[i]), max(rt.y, ps->pos_y[i]) };
+    }
+    // particles move by at most about a smoothing radius per step
+    vec2f margin = { ps->params.smoothing_radius, ps->params.smoothing_radius };
+    Box_Collider2D particles_bounds = { lb - margin, rt + margin };
+
+    if (particle_boundaries.buffer == null) {
+        init(&particle_boundaries, 16);
+    }
+    particle_boundaries.len = 0;
+
+    update_world_space_collider_cache();
+    Collider* cache_it = begin(&world_space_collider_cache);
+    for (auto it = begin(&physics_objects); it != end(&physics_objects); it++, cache_it++) {
+        Box_Collider2D bounds = bounds_of(cache_it);
+        if (!do_intersect(bounds, particles_bounds))
+            continue;
+
+        Particle_Boundary boundary;
+        boundary.collider = *cache_it;
+        if (boundary.collider.type == Collider_Type::Box_Collider2D) {
+            boundary.collider.box_collider2d = bounds;
+        }
+        boundary.velocity = (it->physics_data.is_static ? vec2f(0, 0) : it->physics_data.velocity * physics_velocity_scale);
+        dpush(&particle_boundaries, boundary);
+    }
+}
+
+inline void resolve_particle_boundary(Particle_Params* params, Particle_Boundary* boundary, vec2f* p, vec2f* v) {
+    vec2f n;
+    if (boundary->collider.type == Collider_Type::Box_Collider2D) {
+        Box_Collider2D& c = boundary->collider.box_collider2d;
+        if (!is_contained(c, *p))
+            return;
+
+        // push out through the closest side
+        f32 d_left = p->x - c.lb.x;
+        f32 d_right = c.rt.x - p->x;
+        f32 d_bottom = p->y - c.lb.y;
+        f32 d_top = c.rt.y - p->y;
+        f32 d_min = min(min(d_left, d_right), min(d_bottom, d_top));
+        if (d_min == d_left) {
+            n = { -1, 0 }; p->x = c.lb.x;
+        } else if (d_min == d_right) {
+            n = { 1, 0 }; p->x = c.rt.x;
+        } else if (d_min == d_bottom) {
+            n = { 0, -1 }; p->y = c.lb.y;
+        } else {
+            n = { 0, 1 }; p->y = c.rt.y;
+        }
+    } else {
+        Sphere_Collider2D& c = boundary->collider.sphere_collider2d;
+        vec2f delta = *p - c.origin;
+        f32 dist = magnitude(delta);
+        if (dist >= c.radius)
+            return;
+
+        n = (dist > 1e-6f ? delta / dist : vec2f(0, 1));
+        *p = c.origin + n * c.radius;
+    }
+
+    vec2f rel_v = *v - boundary->velocity;
+    f32 vn = dot(rel_v, n);
+    if (vn < 0) {
+        vec2f tangent_v = rel_v - vn * n;
+        rel_v = tangent_v * (1 - params->friction) - params->restitution * vn * n;
+    }
+    *v = rel_v + boundary->velocity;
+}
+
+void particles_step(Particle_System* ps, f32 dt) {
+    if (ps->count == 0)
+        return;
+
+    sort_particles_by_cell(ps);
+
+    Particle_Params& p = ps->params;
+    f32 h = p.smoothing_radius;
+    f32 h2 = h * h;
+    // 2D kernels from Mueller et al. 2003
+    f32 poly6 = 4 / (M_PI * powf(h, 8));
+    f32 spiky_grad = -30 / (M_PI * powf(h, 5));
+    f32 visc_lap = 40 / (M_PI * powf(h, 5));
+
+    Jobs::parallel_for(ps->count, ps->thread_count, [=, &p](u32 begin, u32 end) {
+        for (u32 i = begin; i < end; i++) {
+            f32 xi = ps->pos_x[i];
+            f32 yi = ps->pos_y[i];
+            f32 density = 0;
+            for_each_neighbor(ps, xi, yi, [&](u32 j) {
+                f32 dx = ps->pos_x[j] - xi;
+                f32 dy = ps->pos_y[j] - yi;
+                f32 r2 = dx * dx + dy * dy;
+                if (r2 < h2) {
+                    f32 w = h2 - r2;
+                    density += w * w * w;
+                }
+            });
+            density *= p.particle_mass * poly6;
+            ps->density[i] = density;
+            ps->pressure[i] = max(p.stiffness * (density - p.rest_density), 0.0f);
+        }
+    });
+
+    // new velocities go to tmp_vel so neighbors keep reading the old ones
+    Jobs::parallel_for(ps->count, ps->thread_count, [=, &p](u32 begin, u32 end) {
+        for (u32 i = begin; i < end; i++) {
+            f32 xi = ps->pos_x[i];
+            f32 yi = ps->pos_y[i];
+            f32 vxi = ps->vel_x[i];
+            f32 vyi = ps->vel_y[i];
+            f32 pi = ps->pressure[i];
+            f32 ax = 0;
+            f32 ay = 0;
+            for_each_neighbor(ps, xi, yi, [&](u32 j) {
+                if (j == i)
+                    return;
+                f32 dx = xi - ps->pos_x[j];
+                f32 dy = yi - ps->pos_y[j];
+                f32 r2 = dx * dx + dy * dy;
+                if (r2 >= h2 || r2 < 1e-12f)
+                    return;
+
+                f32 r = sqrtf(r2);
+                f32 q = h - r;
+                f32 rho_j = ps->density[j];
+                f32 pressure_term = -(pi + ps->pressure[j]) / (2 * rho_j) * spiky_grad * q * q / r;
+                f32 visc_term = p.viscosity * visc_lap * q / rho_j;
+                ax += pressure_term * dx + visc_term * (ps->vel_x[j] - vxi);
+                ay += pressure_term * dy + visc_term * (ps->vel_y[j] - vyi);
+            });
+            f32 k = p.particle_mass / ps->density[i];
+            ps->tmp_vel_x[i] = vxi + (ax * k + p.gravity.x) * dt;
+            ps->tmp_vel_y[i] = vyi + (ay * k + p.gravity.y) * dt;
+        }
+    });
+    std::swap(ps->vel_x, ps->tmp_vel_x);
+    std::swap(ps->vel_y, ps->tmp_vel_y);
+
+    gather_particle_boundaries(ps);
+    Particle_Boundary* boundaries = begin(&particle_boundaries);
+    u32 boundary_count = len(&particle_boundaries);
+
+    Jobs::parallel_for(ps->count, ps->thread_count, [=, &p](u32 begin, u32 end) {
+        for (u32 i = begin; i < end; i++) {
+            vec2f pos = { ps->pos_x[i] + ps->vel_x[i] * dt, ps->pos_y[i] + ps->vel_y[i] * dt };
+            vec2f vel = { ps->vel_x[i], ps->vel_y[i] };
+            for (u32 b = 0; b < boundary_count; b++) {
+                resolve_particle_boundary(&p, &boundaries[b], &pos, &vel);
+            }
+            ps->pos_x[i] = pos.x;
+            ps->pos_y[i] = pos.y;
+            ps->vel_x[i] = vel.x;
+            ps->vel_y[i] = vel.y;
+        }
+    });
+}
+
+// fixed substeps out of frame time, leftover time is dropped past max_substeps
+void particles_update(Particle_System* ps, f32 dt) {
+    auto start = std::chrono::steady_clock::now();
+
+    ps->accumulated_dt += dt;
+    u32 steps = 0;
+    for (; ps->accumulated_dt >= ps->params.fixed_dt; ps->accumulated_dt -= ps->params.fixed_dt) {
+        if (steps == ps->params.max_substeps) {
+            ps->accumulated_dt = 0;
+            break;
+        }
+        particles_step(ps, ps->params.fixed_dt);
+        steps++;
+    }
+
+    if (steps > 0) {
+        ps->last_step_ms = std::chrono::duration<f32, std::milli>(std::chrono::steady_clock::now() - start).count() / steps;
+    }
+}
+
+struct Particle_Benchmark {
+    u32 count;
+    u32 step_count;
+    f32 step_ms;
+    f32 min_step_ms;
+    f32 max_step_ms;
+    // fixed steps of params.fixed_dt that fit into a 60 fps frame
+    f32 steps_per_frame;
+};
+
+// spawns a square block of about count particles at rest spacing around center
+// in a scratch system and times step_count steps, the live particles are left alone
+Particle_Benchmark benchmark_particles(Particle_System* live, u32 count, u32 step_count, vec2f center) {
+    Particle_Benchmark result = {};
+    if (count == 0 || step_count == 0)
+        return result;
+
+    Particle_System ps;
+    init(&ps, count);
+    ps.params = live->params;
+    ps.thread_count = live->thread_count;
+
+    // particle_mass / spacing^2 == rest_density, as the spawn tool does
+    f32 spacing = sqrtf(ps.params.particle_mass / ps.params.rest_density);
+    u32 side = (u32)ceilf(sqrtf((f32)count));
+    // half a spacing of slack so rounding can't drop a row
+    vec2f half_size = vec2f(side * spacing + spacing / 2, side * spacing + spacing / 2) / 2.0f;
+    spawn_particle_block(&ps, center - half_size, center + half_size, spacing);
+
+    result.count = ps.count;
+    result.step_count = step_count;
+    result.min_step_ms = INFINITY;
+    f32 total_ms = 0;
+    for (u32 i = 0; i < step_count; i++) {
+        auto start = std::chrono::steady_clock::now();
+        particles_step(&ps, ps.params.fixed_dt);
+        f32 ms = std::chrono::duration<f32, std::milli>(std::chrono::steady_clock::now() - start).count();
+        total_ms += ms;
+        result.min_step_ms = min(result.min_step_ms, ms);
+        result.max_step_ms = max(result.max_step_ms, ms);
+    }
+    result.step_ms = total_ms / step_count;
+    result.steps_per_frame = (result.step_ms > 0 ? (1000.0f / 60) / result.step_ms : 0);
+    shut(&ps);
+
+    printf("particle benchmark, %u particles, %u steps, %u threads\n", result.count, step_count, live->thread_count);
+    printf("  %.3f ms/step (min %.3f, max %.3f), %.1f steps fit a 60 fps frame (%u substeps wanted)\n",
+        result.step_ms, result.min_step_ms, result.max_step_ms, result.steps_per_frame,
+        (u32)ceilf((1.0f / 60) / live->params.fixed_dt));
+    return result;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "cp_lib/basic.cc"
+
+// Hardware event counters for profiling the step, Linux only (perf_event_open).
+// Elsewhere, or when the kernel doesn't allow it, counters read as 0.
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#endif
+
+struct Perf_Counter {
+    i32 fd = -1;
+};
+
+bool open_cache_miss_counter(Perf_Counter* counter) {
+#if defined(__linux__)
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    counter->fd = (i32)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    return counter->fd >= 0;
+#else
+    counter->fd = -1;
+    return false;
+#endif
+}
+
+u64 read_counter(Perf_Counter* counter) {
+#if defined(__linux__)
+    u64 value = 0;
+    if (counter->fd >= 0 && read(counter->fd, &value, sizeof(value)) == sizeof(value))
+        return value;
+#endif
+    return 0;
+}
+
+void close_counter(Perf_Counter* counter) {
+#if defined(__linux__)
+    if (counter->fd >= 0)
+        close(counter->fd);
+#endif
+    counter->fd = -1;
+}
@@ -1,6 +1,13 @@
 #pragma once
 #include "gpu_graphics/draw.cc"
 
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <utility>
+#include <algorithm>
+
 
 using Box_Collider2D = Rect<f32>;
 
@@ -40,10 +47,19 @@ bool is_contained(Collider *c, vec2f p) {
     return false;
 }
 
+// which contact events a body listens to, stored in Physics_Data::contact_events
+enum Contact_Event_Type : u8 {
+    Contact_Begin = 1 << 0,
+    Contact_Stay = 1 << 1,
+    Contact_End = 1 << 2
+};
+
 struct Physics_Data {
     f32 mass;
     vec2f velocity;
     bool is_static;
+    // fits in the padding after is_static, so save files keep their layout
+    u8 contact_events;
 };
 
 struct Physics_Object {
@@ -57,6 +73,66 @@ struct Physics_Object {
 
 darr<Physics_Object> physics_objects;
 
+// Body names point at static strings: literals or names interned here, which
+// are never freed. Files store bodies raw, so on disk the name pointer is
+// replaced by a hash of the string (pack_physics_object_names) and loads look
+// the hash up among the interned names (unpack_physics_object_names). A name
+// that isn't interned in this run falls back to the collider type.
+const char* collider_type_name(Collider_Type type) {
+    return (type == Collider_Type::Sphere_Collider2D ? "Sphere" : "Box");
+}
+
+struct Physics_Name {
+    u64 key;
+    const char* text;
+};
+
+darr<Physics_Name> physics_names;
+
+u64 physics_name_key(const char* name) {
+    u64 h = 0xcbf29ce484222325ull;
+    for (const char* it = name; *it != 0; it++) {
+        h = (h ^ (u8)*it) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+// main thread only, loads of chunk files resolve names when they are integrated
+const char* intern_physics_name(const char* name) {
+    if (physics_names.buffer == null) {
+        init(&physics_names, 16);
+    }
+    u64 key = physics_name_key(name);
+    for (auto it = begin(&physics_names); it != end(&physics_names); it++) {
+        if (it->key == key)
+            return it->text;
+    }
+    u32 size = strlen(name) + 1;
+    char* text = m_alloc<char>(size);
+    memcpy(text, name, size);
+    dpush(&physics_names, { key, (const char*)text });
+    return text;
+}
+
+void pack_physics_object_names(Physics_Object* objects, u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        objects[i].name = (const char*)(uintptr_t)physics_name_key(objects[i].name);
+    }
+}
+
+void unpack_physics_object_names(Physics_Object* objects, u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        u64 key = (uintptr_t)objects[i].name;
+        objects[i].name = collider_type_name(objects[i].collider.type);
+        for (auto it = begin(&physics_names); it != end(&physics_names); it++) {
+            if (it->key == key) {
+                objects[i].name = it->text;
+                break;
+            }
+        }
+    }
+}
+
 
 
 
@@ -153,6 +229,17 @@ Sphere_Collider2D world_space_collider_s(Physics_Object *obj) {
 }
 
 
+// axis aligned bounds of a world space collider, lb <= rt even if the transform flips it
+Box_Collider2D bounds_of(Collider* c) {
+    if (c->type == Collider_Type::Box_Collider2D) {
+        Box_Collider2D& bc = c->box_collider2d;
+        return { { min(bc.lb.x, bc.rt.x), min(bc.lb.y, bc.rt.y) }, { max(bc.lb.x, bc.rt.x), max(bc.lb.y, bc.rt.y) } };
+    } else {
+        Sphere_Collider2D& sc = c->sphere_collider2d;
+        return { sc.origin - vec2f(sc.radius, sc.radius), sc.origin + vec2f(sc.radius, sc.radius) };
+    }
+}
+
 vec2f min_vec(vec2f v1, vec2f v2) {
     return (magnitude(v1) < magnitude(v2) ? v1 : v2);
 }
@@ -176,12 +263,19 @@ void update_world_space_collider_cache() {
     }
 }
 
-void resolve_collision_bb(Physics_Object* b1, Physics_Object *b2, Collider *c1, Collider *c2) {
+// only the listed bodies, the cache has to be up to date for the rest
+void update_world_space_collider_cache(const u32* indices, u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        world_space_collider_cache[indices[i]] = world_space_collider(&physics_objects[indices[i]]);
+    }
+}
+
+bool resolve_collision_bb(Physics_Object* b1, Physics_Object *b2, Collider *c1, Collider *c2) {
     Box_Collider2D& bc1 = c1->box_collider2d;
     Box_Collider2D& bc2 = c2->box_collider2d;
 
     // if (do_go_away_from_each_other(centerof(bc1), centerof(bc2), b1->physics_data.velocity, b2->physics_data.velocity)) return;
-    if (!do_collide(&bc1, &bc2)) return;
+    if (!do_collide(&bc1, &bc2)) return false;
 
     Physics_Data& data1 = b1->physics_data;
     Physics_Data& data2 = b2->physics_data;
@@ -208,7 +302,7 @@ void resolve_collision_bb(Physics_Object* b1, Physics_Object *b2, Collider *c1,
         }
     }
     // colliders stuck in each other bug fix (sort of)
-    if (do_go_away_from_each_other({0, 0}, delta, b2->physics_data.velocity, b1->physics_data.velocity)) return;
+    if (do_go_away_from_each_other({0, 0}, delta, b2->physics_data.velocity, b1->physics_data.velocity)) return true;
 
     f32 sm_delta = delta.x * delta.x + delta.y * delta.y;
 
@@ -232,14 +326,15 @@ void resolve_collision_bb(Physics_Object* b1, Physics_Object *b2, Collider *c1,
 
     data1.velocity = new_velocity1;
     data2.velocity = new_velocity2;
+    return true;
 }
-void resolve_collision_ss(Physics_Object* s1, Physics_Object *s2, Collider *c1, Collider *c2) {
+bool resolve_collision_ss(Physics_Object* s1, Physics_Object *s2, Collider *c1, Collider *c2) {
     Sphere_Collider2D& sc1 = c1->sphere_collider2d;
     Sphere_Collider2D& sc2 = c2->sphere_collider2d;
 
+    if (!do_collide(&sc1, &sc2)) return false;
     // colliders stuck in each other bug fix (sort of)
-    if (do_go_away_from_each_other(sc1.origin, sc2.origin, s1->physics_data.velocity, s2->physics_data.velocity)) return;
-    if (!do_collide(&sc1, &sc2)) return;
+    if (do_go_away_from_each_other(sc1.origin, sc2.origin, s1->physics_data.velocity, s2->physics_data.velocity)) return true;
 
     Physics_Data& data1 = s1->physics_data;
     Physics_Data& data2 = s2->physics_data;
@@ -267,14 +362,15 @@ void resolve_collision_ss(Physics_Object* s1, Physics_Object *s2, Collider *c1,
 
     data1.velocity = new_velocity1;
     data2.velocity = new_velocity2;
+    return true;
 }
 
 
-void resolve_collision_bs(Physics_Object* b, Physics_Object *s, Collider *c1, Collider *c2) {
+bool resolve_collision_bs(Physics_Object* b, Physics_Object *s, Collider *c1, Collider *c2) {
     Box_Collider2D& bc = c1->box_collider2d; 
     Sphere_Collider2D& sc = c2->sphere_collider2d;
 
-    if (!do_collide(&bc, &sc)) return;
+    if (!do_collide(&bc, &sc)) return false;
 
     vec2f lb = bc.lb;
     vec2f rt = bc.rt;
@@ -288,7 +384,7 @@ void resolve_collision_bs(Physics_Object* b, Physics_Object *s, Collider *c1, Co
 
     vec2f delta = min_vec(min_vec(delta1, delta2), min_vec(delta3, delta4));
     // colliders stuck in each other bug fix (sort of)
-    if (do_go_away_from_each_other({0, 0}, delta, s->physics_data.velocity, b->physics_data.velocity)) return;
+    if (do_go_away_from_each_other({0, 0}, delta, s->physics_data.velocity, b->physics_data.velocity)) return true;
 
     Physics_Data& data1 = b->physics_data;
     Physics_Data& data2 = s->physics_data;
@@ -315,21 +411,553 @@ void resolve_collision_bs(Physics_Object* b, Physics_Object *s, Collider *c1, Co
 
     data1.velocity = new_velocity1;
     data2.velocity = new_velocity2;
+    return true;
 }
 
-void resolve_collision_sb(Physics_Object *obj1, Physics_Object *obj2, Collider *c1, Collider *c2) {
-    resolve_collision_bs(obj2, obj1, c2, c1);
+bool resolve_collision_sb(Physics_Object *obj1, Physics_Object *obj2, Collider *c1, Collider *c2) {
+    return resolve_collision_bs(obj2, obj1, c2, c1);
 }
 
-void(*resolve_collision_matrix[(u32)Collider_Type::count][(u32)Collider_Type::count])(Physics_Object*, Physics_Object*, Collider*, Collider*) {
+bool(*resolve_collision_matrix[(u32)Collider_Type::count][(u32)Collider_Type::count])(Physics_Object*, Physics_Object*, Collider*, Collider*) {
     { resolve_collision_bb, resolve_collision_bs },
     { resolve_collision_sb, resolve_collision_ss }
 };
 
-void resolve_collision(Physics_Object* obj1, Physics_Object *obj2, Collider *c1, Collider* c2) {
-    resolve_collision_matrix[(u32)obj1->collider.type][(u32)obj2->collider.type](obj1, obj2, c1, c2);
+// true if the colliders touch, whether or not velocities were changed
+bool resolve_collision(Physics_Object* obj1, Physics_Object *obj2, Collider *c1, Collider* c2) {
+    return resolve_collision_matrix[(u32)obj1->collider.type][(u32)obj2->collider.type](obj1, obj2, c1, c2);
+}
+
+
+// Bodies get reordered (morton sort) and removed, anything holding indices or
+// pointers into physics_objects listens for the remap to stay valid.
+// remap[old_index] is the new index, or physics_removed_index.
+const u32 physics_removed_index = UINT32_MAX;
+
+typedef void(*Physics_Remap_Fn)(const u32* remap, u32 old_len);
+
+darr<Physics_Remap_Fn> physics_remap_listeners;
+
+void add_physics_remap_listener(Physics_Remap_Fn fn) {
+    if (physics_remap_listeners.buffer == null) {
+        init(&physics_remap_listeners, 4);
+    }
+    dpush(&physics_remap_listeners, fn);
+}
+
+void notify_physics_remap(const u32* remap, u32 old_len) {
+    for (auto it = begin(&physics_remap_listeners); it != end(&physics_remap_listeners); it++) {
+        (*it)(remap, old_len);
+    }
+}
+
+darr<u32> physics_remap_scratch;
+
+template <typename T>
+void fit_len(darr<T>* arr, u32 len) {
+    if (arr->buffer == null) {
+        init(arr, max(len, 16u));
+    }
+    if (arr->cap < len) {
+        arr->buffer = m_ralloc(arr->buffer, len);
+        arr->cap = len;
+    }
+    arr->len = len;
+}
+
+template <typename T>
+void shut_if_init(darr<T>* arr) {
+    if (arr->buffer != null) {
+        shut(arr);
+    }
+}
+
+// removes bodies in one compaction pass, keeps the order of the remaining ones
+void remove_physics_objects(const u32* indices, u32 count) {
+    u32 old_len = len(&physics_objects);
+    fit_len(&physics_remap_scratch, old_len);
+    u32* remap = begin(&physics_remap_scratch);
+    memset(remap, 0, sizeof(u32) * old_len);
+    for (u32 i = 0; i < count; i++) {
+        remap[indices[i]] = physics_removed_index;
+    }
+
+    u32 new_len = 0;
+    for (u32 i = 0; i < old_len; i++) {
+        if (remap[i] == physics_removed_index)
+            continue;
+        if (new_len != i) {
+            physics_objects[new_len] = physics_objects[i];
+        }
+        remap[i] = new_len++;
+    }
+    physics_objects.len = new_len;
+
+    notify_physics_remap(remap, old_len);
+}
+
+void remove_physics_object(u32 index) {
+    remove_physics_objects(&index, 1);
+}
+
+// grows physics_objects by count and returns the first new slot for the caller to fill,
+// listeners get an identity remap when the buffer had to move, so they can refresh pointers
+Physics_Object* push_physics_objects(u32 count) {
+    if (physics_objects.buffer == null) {
+        init(&physics_objects, max(count, 16u));
+    }
+
+    u32 old_len = len(&physics_objects);
+    Physics_Object* old_buffer = physics_objects.buffer;
+    if (old_len + count > physics_objects.cap) {
+        u32 new_cap = max(physics_objects.cap * 2, old_len + count);
+        physics_objects.buffer = m_ralloc(physics_objects.buffer, new_cap);
+        physics_objects.cap = new_cap;
+    }
+    physics_objects.len += count;
+
+    if (physics_objects.buffer != old_buffer && old_len > 0) {
+        fit_len(&physics_remap_scratch, old_len);
+        for (u32 i = 0; i < old_len; i++) {
+            physics_remap_scratch[i] = i;
+        }
+        notify_physics_remap(begin(&physics_remap_scratch), old_len);
+    }
+    return physics_objects.buffer + old_len;
 }
 
+void append_physics_objects(const Physics_Object* objects, u32 count) {
+    memcpy(push_physics_objects(count), objects, sizeof(Physics_Object) * count);
+}
+
+// count copies of prefab placed at positions[i] (z from the prefab), velocities may be null
+// to keep the prefab's velocity, returns the index of the first spawned body
+u32 spawn_physics_objects(const Physics_Object* prefab, const vec2f* positions, const vec2f* velocities, u32 count) {
+    // prefab may point into physics_objects, copy it before the buffer can move
+    Physics_Object p = *prefab;
+    u32 first = len(&physics_objects);
+    Physics_Object* out = push_physics_objects(count);
+    for (u32 i = 0; i < count; i++) {
+        out[i] = p;
+        out[i].transform.position.x = positions[i].x;
+        out[i].transform.position.y = positions[i].y;
+    }
+    if (velocities != null) {
+        for (u32 i = 0; i < count; i++) {
+            out[i].physics_data.velocity = velocities[i];
+        }
+    }
+    return first;
+}
+
+// indices of bodies whose world space collider bounds overlap box
+void query_aabb(Box_Collider2D box, darr<u32>* out) {
+    out->len = 0;
+    u32 i = 0;
+    for (auto it = begin(&physics_objects); it != end(&physics_objects); it++, i++) {
+        Collider c = world_space_collider(it);
+        if (do_intersect(bounds_of(&c), box)) {
+            dpush(out, i);
+        }
+    }
+}
+
+// Periodic re-sort of physics_objects along a Z-order curve, so bodies that
+// are close in space are close in memory.
+// The pair loop resolves velocities in index order, so a sort changes the
+// order of resolution and with it the results, not only the speed. And the
+// pair loop visits every pair whatever the order, so without a broadphase
+// that walks neighbors there is little locality to gain yet.
+struct {
+    bool is_enabled = false;
+    u32 interval = 360;
+    u32 steps_since_sort = 0;
+    f32 last_sort_ms = 0;
+
+    darr<u32> keys;
+    darr<u32> indices;
+    darr<u32> tmp_keys;
+    darr<u32> tmp_indices;
+    darr<u32> remap;
+    darr<Physics_Object> tmp_objects;
+} Morton_Sort;
+
+inline u32 spread_bits16(u32 x) {
+    x &= 0xffff;
+    x = (x | (x << 8)) & 0x00ff00ff;
+    x = (x | (x << 4)) & 0x0f0f0f0f;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return x;
+}
+
+inline u32 morton_code(u32 x, u32 y) {
+    return spread_bits16(x) | (spread_bits16(y) << 1);
+}
+
+// LSD radix sort of (key, index) pairs, 8 bits per pass
+void radix_sort(u32* keys, u32* indices, u32* tmp_keys, u32* tmp_indices, u32 count) {
+    for (u32 shift = 0; shift < 32; shift += 8) {
+        u32 offsets[256] = {};
+        for (u32 i = 0; i < count; i++) {
+            offsets[(keys[i] >> shift) & 0xff]++;
+        }
+        u32 sum = 0;
+        for (u32 b = 0; b < 256; b++) {
+            u32 c = offsets[b];
+            offsets[b] = sum;
+            sum += c;
+        }
+        for (u32 i = 0; i < count; i++) {
+            u32 dst = offsets[(keys[i] >> shift) & 0xff]++;
+            tmp_keys[dst] = keys[i];
+            tmp_indices[dst] = indices[i];
+        }
+        std::swap(keys, tmp_keys);
+        std::swap(indices, tmp_indices);
+    }
+    // even number of passes, sorted data is back in keys/indices
+}
+
+void morton_sort_physics_objects() {
+    auto start = std::chrono::steady_clock::now();
+
+    u32 count = len(&physics_objects);
+    if (count < 2)
+        return;
+
+    vec2f lb = (vec2f)physics_objects[0].transform.position;
+    vec2f rt = lb;
+    for (auto it = begin(&physics_objects); it != end(&physics_objects); it++) {
+        vec2f p = (vec2f)it->transform.position;
+        lb = { min(lb.x, p.x), min(lb.y, p.y) };
+        rt = { max(rt.x, p.x), max(rt.y, p.y) };
+    }
+    vec2f extent = rt - lb;
+    f32 scale_x = (extent.x > 0 ? 65535 / extent.x : 0);
+    f32 scale_y = (extent.y > 0 ? 65535 / extent.y : 0);
+
+    fit_len(&Morton_Sort.keys, count);
+    fit_len(&Morton_Sort.indices, count);
+    fit_len(&Morton_Sort.tmp_keys, count);
+    fit_len(&Morton_Sort.tmp_indices, count);
+    fit_len(&Morton_Sort.remap, count);
+    fit_len(&Morton_Sort.tmp_objects, count);
+
+    for (u32 i = 0; i < count; i++) {
+        vec2f p = (vec2f)physics_objects[i].transform.position;
+        Morton_Sort.keys[i] = morton_code((u32)((p.x - lb.x) * scale_x), (u32)((p.y - lb.y) * scale_y));
+        Morton_Sort.indices[i] = i;
+    }
+
+    radix_sort(begin(&Morton_Sort.keys), begin(&Morton_Sort.indices),
+        begin(&Morton_Sort.tmp_keys), begin(&Morton_Sort.tmp_indices), count);
+
+    bool is_changed = false;
+    for (u32 i = 0; i < count; i++) {
+        u32 old_index = Morton_Sort.indices[i];
+        Morton_Sort.tmp_objects[i] = physics_objects[old_index];
+        Morton_Sort.remap[old_index] = i;
+        is_changed |= (old_index != i);
+    }
+
+    if (is_changed) {
+        memcpy(begin(&physics_objects), begin(&Morton_Sort.tmp_objects), sizeof(Physics_Object) * count);
+        notify_physics_remap(begin(&Morton_Sort.remap), count);
+    }
+
+    Morton_Sort.steps_since_sort = 0;
+    Morton_Sort.last_sort_ms = std::chrono::duration<f32, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+// Contact events. Pairs touching this step, where at least one body listens,
+// are diffed against the previous step's pairs. Both lists are sorted by
+// (a, b), a < b, so the diff is a single merge.
+struct Contact_Pair {
+    u32 a;
+    u32 b;
+};
+
+struct Contact_Event {
+    u32 a;
+    u32 b;
+    Contact_Event_Type type;
+};
+
+struct Contact_State {
+    darr<Contact_Pair> current;
+    darr<Contact_Pair> previous;
+    // appended every step until the consumer calls clear_contact_events
+    darr<Contact_Event> events;
+};
+
+Contact_State contacts;
+
+void init(Contact_State* state) {
+    init(&state->current, 64);
+    init(&state->previous, 64);
+    init(&state->events, 64);
+}
+
+void shut(Contact_State* state) {
+    shut(&state->current);
+    shut(&state->previous);
+    shut(&state->events);
+}
+
+void clear_contact_events() {
+    contacts.events.len = 0;
+}
+
+// forget every contact, for when indices no longer mean the same bodies (scene load)
+void reset_contacts() {
+    contacts.current.len = 0;
+    contacts.previous.len = 0;
+    contacts.events.len = 0;
+}
+
+inline bool operator<(Contact_Pair p1, Contact_Pair p2) {
+    return p1.a < p2.a || (p1.a == p2.a && p1.b < p2.b);
+}
+
+inline void push_contact_event(Contact_Pair pair, Contact_Event_Type type) {
+    u8 mask = physics_objects[pair.a].physics_data.contact_events | physics_objects[pair.b].physics_data.contact_events;
+    if (mask & type) {
+        dpush(&contacts.events, { pair.a, pair.b, type });
+    }
+}
+
+void emit_contact_events() {
+    darr<Contact_Pair>& prev = contacts.previous;
+    darr<Contact_Pair>& cur = contacts.current;
+    u32 i = 0, j = 0;
+    while (i < len(&prev) || j < len(&cur)) {
+        if (j == len(&cur) || (i < len(&prev) && prev[i] < cur[j])) {
+            push_contact_event(prev[i++], Contact_End);
+        } else if (i == len(&prev) || cur[j] < prev[i]) {
+            push_contact_event(cur[j++], Contact_Begin);
+        } else {
+            push_contact_event(cur[j++], Contact_Stay);
+            i++;
+        }
+    }
+
+    std::swap(contacts.previous, contacts.current);
+    contacts.current.len = 0;
+}
+
+// events keep bodies that were removed as physics_removed_index, and a contact
+// that ends because a body was removed gets its Contact_End that way
+void on_contacts_remap(const u32* remap, u32 old_len) {
+    for (u32 i = 0; i < len(&contacts.events); i++) {
+        Contact_Event& e = contacts.events[i];
+        // may already be gone from an earlier remap
+        e.a = (e.a == physics_removed_index ? e.a : remap[e.a]);
+        e.b = (e.b == physics_removed_index ? e.b : remap[e.b]);
+    }
+
+    u32 new_len = 0;
+    for (u32 i = 0; i < len(&contacts.previous); i++) {
+        Contact_Pair p = contacts.previous[i];
+        u32 a = remap[p.a];
+        u32 b = remap[p.b];
+        if (a == physics_removed_index || b == physics_removed_index) {
+            // the removed body's flags are gone, so this one is sent whatever they were
+            dpush(&contacts.events, { a, b, Contact_End });
+            continue;
+        }
+        contacts.previous[new_len++] = { min(a, b), max(a, b) };
+    }
+    contacts.previous.len = new_len;
+    std::sort(begin(&contacts.previous), end(&contacts.previous));
+}
+
+
+// Simulation LOD. Bodies far from every point of interest step every few ticks
+// with the time they skipped (mid), or only rarely / not at all (far). A body
+// touched by a body of a finer tier is raised to that tier until the next
+// assignment, so both sides of the pair react on time.
+// Only bodies that step this tick enter the pair loop and get their world space
+// collider refreshed, so an idle body costs a few bytes of bookkeeping per
+// tick plus one test against each active body. Idle bodies don't move, their
+// cached colliders are refreshed in full at every tier assignment, which also
+// picks up edits made to them in the meantime.
+enum Sim_Tier : u8 {
+    Sim_Near = 0,
+    Sim_Mid = 1,
+    Sim_Far = 2,
+};
+
+enum class Far_Mode : u8 {
+    Frozen,
+    Coarse,
+};
+
+struct {
+    bool is_enabled = false;
+    // distances from the nearest point of interest
+    f32 near_radius = 20;
+    f32 mid_radius = 60;
+    // a body only moves to a coarser tier past radius * (1 + hysteresis)
+    f32 hysteresis = 0.1f;
+    u32 mid_interval = 4;
+    u32 far_interval = 32;
+    Far_Mode far_mode = Far_Mode::Frozen;
+    // ticks between tier assignments
+    u32 assign_interval = 36;
+
+    darr<vec2f> points;
+
+    u64 tick = 0;
+    // per body, follow physics_objects through remaps
+    darr<u8> tiers;
+    darr<f32> pending_dt;
+    darr<u8> is_active;
+    darr<u8> tmp_tiers;
+    darr<f32> tmp_pending_dt;
+    // bodies stepping this tick, ascending
+    darr<u32> active_indices;
+    // false until the collider cache holds every body at its current index
+    bool is_cache_valid;
+
+    u32 tier_counts[3];
+    u32 active_count;
+} Sim_Lod;
+
+typedef decltype(Sim_Lod) Sim_Lod_Type;
+
+void clear_sim_lod_points() {
+    if (Sim_Lod.points.buffer == null) {
+        init(&Sim_Lod.points, 4);
+    }
+    Sim_Lod.points.len = 0;
+}
+
+void add_sim_lod_point(vec2f p) {
+    if (Sim_Lod.points.buffer == null) {
+        init(&Sim_Lod.points, 4);
+    }
+    dpush(&Sim_Lod.points, p);
+}
+
+// new bodies start near with nothing pending
+void sync_sim_lod_len() {
+    u32 count = len(&physics_objects);
+    if (len(&Sim_Lod.tiers) != count) {
+        Sim_Lod.is_cache_valid = false;
+    }
+    u32 old_len = min(len(&Sim_Lod.tiers), count);
+    fit_len(&Sim_Lod.tiers, count);
+    fit_len(&Sim_Lod.pending_dt, count);
+    fit_len(&Sim_Lod.is_active, count);
+    for (u32 i = old_len; i < count; i++) {
+        Sim_Lod.tiers[i] = Sim_Near;
+        Sim_Lod.pending_dt[i] = 0;
+    }
+}
+
+void reset_sim_lod() {
+    Sim_Lod.tiers.len = 0;
+    Sim_Lod.pending_dt.len = 0;
+    Sim_Lod.tick = 0;
+    Sim_Lod.is_cache_valid = false;
+}
+
+// moves the live run state aside for steps that get rewound (benchmarks, the
+// determinism check), the settings and points stay
+void stash_sim_lod(Sim_Lod_Type* stash) {
+    *stash = Sim_Lod;
+    Sim_Lod.tiers = {};
+    Sim_Lod.pending_dt = {};
+    Sim_Lod.is_active = {};
+    Sim_Lod.tmp_tiers = {};
+    Sim_Lod.tmp_pending_dt = {};
+    Sim_Lod.active_indices = {};
+    Sim_Lod.is_cache_valid = false;
+    Sim_Lod.tick = 0;
+    Sim_Lod.tier_counts[Sim_Near] = Sim_Lod.tier_counts[Sim_Mid] = Sim_Lod.tier_counts[Sim_Far] = 0;
+    Sim_Lod.active_count = 0;
+}
+
+// the settings go back too, so a run can change them freely
+void unstash_sim_lod(Sim_Lod_Type* stash) {
+    shut_if_init(&Sim_Lod.tiers);
+    shut_if_init(&Sim_Lod.pending_dt);
+    shut_if_init(&Sim_Lod.is_active);
+    shut_if_init(&Sim_Lod.tmp_tiers);
+    shut_if_init(&Sim_Lod.tmp_pending_dt);
+    shut_if_init(&Sim_Lod.active_indices);
+    Sim_Lod = *stash;
+    // the run stepped the shared collider cache
+    Sim_Lod.is_cache_valid = false;
+}
+
+// bodies appended since the last step have no entry yet, they come out near with nothing pending
+void on_sim_lod_remap(const u32* remap, u32 old_len) {
+    Sim_Lod.is_cache_valid = false;
+    if (len(&Sim_Lod.tiers) == 0)
+        return;
+    u32 known_len = min(len(&Sim_Lod.tiers), old_len);
+    u32 count = len(&physics_objects);
+    fit_len(&Sim_Lod.tmp_tiers, count);
+    fit_len(&Sim_Lod.tmp_pending_dt, count);
+    memset(begin(&Sim_Lod.tmp_tiers), Sim_Near, count);
+    memset(begin(&Sim_Lod.tmp_pending_dt), 0, sizeof(f32) * count);
+    for (u32 i = 0; i < known_len; i++) {
+        if (remap[i] == physics_removed_index)
+            continue;
+        Sim_Lod.tmp_tiers[remap[i]] = Sim_Lod.tiers[i];
+        Sim_Lod.tmp_pending_dt[remap[i]] = Sim_Lod.pending_dt[i];
+    }
+    std::swap(Sim_Lod.tiers, Sim_Lod.tmp_tiers);
+    std::swap(Sim_Lod.pending_dt, Sim_Lod.tmp_pending_dt);
+    Sim_Lod.is_cache_valid = false;
+}
+
+void assign_sim_tiers() {
+    Sim_Lod.tier_counts[Sim_Near] = Sim_Lod.tier_counts[Sim_Mid] = Sim_Lod.tier_counts[Sim_Far] = 0;
+    f32 h = 1 + Sim_Lod.hysteresis;
+    for (u32 i = 0; i < len(&physics_objects); i++) {
+        Physics_Object* obj = &physics_objects[i];
+        u8 cur = Sim_Lod.tiers[i];
+        u8 tier = Sim_Near;
+        // bodies gameplay listens to always run at full rate
+        if (len(&Sim_Lod.points) > 0 && obj->physics_data.contact_events == 0) {
+            vec2f p = (vec2f)obj->transform.position;
+            f32 d2 = INFINITY;
+            for (auto it = begin(&Sim_Lod.points); it != end(&Sim_Lod.points); it++) {
+                vec2f d = p - *it;
+                d2 = min(d2, dot(d, d));
+            }
+            f32 near_limit = Sim_Lod.near_radius * (cur == Sim_Near ? h : 1);
+            f32 mid_limit = Sim_Lod.mid_radius * (cur != Sim_Far ? h : 1);
+            tier = (d2 < near_limit * near_limit ? Sim_Near : d2 < mid_limit * mid_limit ? Sim_Mid : Sim_Far);
+        }
+        Sim_Lod.tiers[i] = tier;
+        Sim_Lod.tier_counts[tier]++;
+    }
+}
+
+// advances pending time and marks who steps this tick, returns the dt body i integrates now (0 if inactive)
+inline f32 sim_lod_step_dt(u32 i, f32 fixed_dt) {
+    u8 tier = Sim_Lod.tiers[i];
+    bool is_frozen = (tier == Sim_Far && Sim_Lod.far_mode == Far_Mode::Frozen);
+    if (!is_frozen) {
+        Sim_Lod.pending_dt[i] += fixed_dt;
+    }
+    // staggered by index so the coarse tiers spread over ticks
+    u64 phase = Sim_Lod.tick + i;
+    bool is_active = tier == Sim_Near ||
+        (tier == Sim_Mid && phase % Sim_Lod.mid_interval == 0) ||
+        (tier == Sim_Far && !is_frozen && phase % Sim_Lod.far_interval == 0);
+    Sim_Lod.is_active[i] = is_active;
+    if (!is_active)
+        return 0;
+    f32 dt = Sim_Lod.pending_dt[i];
+    Sim_Lod.pending_dt[i] = 0;
+    return dt;
+}
 
 Physics_Object* is_over(vec2f p) {
     f32 depth = INT_MIN;
@@ -351,25 +979,112 @@ void apply_force(vec2f force, f32 dt) {
 
 vec2f gravity = {0, -90.8f};
 
+// bodies move by velocity * physics_velocity_scale per unit of time
+const f32 physics_velocity_scale = 0.1f;
+
 void apply_gravity() {
     
 }
 
+// one pair of the lod pair loop, a < b, passed in that order like the full loop does
+inline void resolve_sim_lod_pair(u32 a, u32 b) {
+    Physics_Object* obj1 = &physics_objects[a];
+    Physics_Object* obj2 = &physics_objects[b];
+    bool is_touching = resolve_collision(obj1, obj2, &world_space_collider_cache[a], &world_space_collider_cache[b]);
+    if (is_touching && Sim_Lod.tiers[a] != Sim_Lod.tiers[b]) {
+        u8 tier = min(Sim_Lod.tiers[a], Sim_Lod.tiers[b]);
+        Sim_Lod.tiers[a] = Sim_Lod.tiers[b] = tier;
+    }
+    if (is_touching && (obj1->physics_data.contact_events | obj2->physics_data.contact_events)) {
+        dpush(&contacts.current, { a, b });
+    }
+}
+
 void physics_update() {
+    if (Morton_Sort.is_enabled && ++Morton_Sort.steps_since_sort >= Morton_Sort.interval) {
+        morton_sort_physics_objects();
+    }
+
+    bool is_lod = Sim_Lod.is_enabled;
+    bool is_assign_tick = false;
+    if (is_lod) {
+        sync_sim_lod_len();
+        is_assign_tick = Sim_Lod.tick % Sim_Lod.assign_interval == 0;
+        if (is_assign_tick) {
+            assign_sim_tiers();
+        }
+        fit_len(&Sim_Lod.active_indices, 0);
+    } else if (len(&Sim_Lod.tiers) > 0) {
+        // lod was turned off, catch up on the skipped time once, bodies added since have none
+        u32 known_len = min(len(&Sim_Lod.pending_dt), len(&physics_objects));
+        for (u32 i = 0; i < known_len; i++) {
+            Physics_Object* obj = &physics_objects[i];
+            obj->transform.position += vec3f(obj->physics_data.velocity, 0) * physics_velocity_scale * Sim_Lod.pending_dt[i];
+        }
+        reset_sim_lod();
+    }
+
     // void apply_gravity();
-    for (auto it = begin(&physics_objects); it != end(&physics_objects); it++) {
+    u32 index = 0;
+    for (auto it = begin(&physics_objects); it != end(&physics_objects); it++, index++) {
         // if (it->collider.type == Collider_Type::Sphere_Collider2D)
         //     it->physics_data.velocity += gravity * GTime::fixed_dt;
-        it->transform.position += vec3f(it->physics_data.velocity, 0) * 0.1f * GTime::fixed_dt;
+        f32 dt = GTime::fixed_dt;
+        if (is_lod) {
+            dt = sim_lod_step_dt(index, GTime::fixed_dt);
+            if (!Sim_Lod.is_active[index])
+                continue;
+            dpush(&Sim_Lod.active_indices, index);
+        }
+        it->transform.position += vec3f(it->physics_data.velocity, 0) * physics_velocity_scale * dt;
     }
 
-    update_world_space_collider_cache();
-    Collider* cache_it1 = begin(&world_space_collider_cache);
-    for (auto it1 = begin(&physics_objects); it1 != end(&physics_objects); it1++, cache_it1++) {
-        Collider* cache_it2 = cache_it1 + 1;
-        for (auto it2 = it1 + 1; it2 != end(&physics_objects); it2++, cache_it2++) {
-            resolve_collision(it1, it2, cache_it1, cache_it2);
+    if (contacts.events.buffer == null) {
+        init(&contacts);
+    }
+
+    if (!is_lod) {
+        update_world_space_collider_cache();
+        Collider* cache_it1 = begin(&world_space_collider_cache);
+        for (auto it1 = begin(&physics_objects); it1 != end(&physics_objects); it1++, cache_it1++) {
+            Collider* cache_it2 = cache_it1 + 1;
+            for (auto it2 = it1 + 1; it2 != end(&physics_objects); it2++, cache_it2++) {
+                bool is_touching = resolve_collision(it1, it2, cache_it1, cache_it2);
+                // pairs are visited in (a, b) order, so current comes out sorted
+                if (is_touching && (it1->physics_data.contact_events | it2->physics_data.contact_events)) {
+                    dpush(&contacts.current, { (u32)(it1 - begin(&physics_objects)), (u32)(it2 - begin(&physics_objects)) });
+                }
+            }
         }
+        emit_contact_events();
+        return;
+    }
+
+    u32* active = begin(&Sim_Lod.active_indices);
+    u32 active_count = len(&Sim_Lod.active_indices);
+    Sim_Lod.active_count = active_count;
+    if (is_assign_tick || !Sim_Lod.is_cache_valid) {
+        update_world_space_collider_cache();
+        Sim_Lod.is_cache_valid = true;
+    } else {
+        update_world_space_collider_cache(active, active_count);
     }
-}
 
+    // pairs with an active body only, a pair of active bodies is taken from its lower index
+    u32 count = len(&physics_objects);
+    for (u32 k = 0; k < active_count; k++) {
+        u32 a = active[k];
+        for (u32 b = 0; b < a; b++) {
+            if (!Sim_Lod.is_active[b]) {
+                resolve_sim_lod_pair(b, a);
+            }
+        }
+        for (u32 b = a + 1; b < count; b++) {
+            resolve_sim_lod_pair(a, b);
+        }
+    }
+    std::sort(begin(&contacts.current), end(&contacts.current));
+    emit_contact_events();
+
+    Sim_Lod.tick++;
+}
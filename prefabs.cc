@@ -0,0 +1,85 @@
+#pragma once
+#include "physics.cc"
+#include "asset_bundle.cc"
+
+#include <stdio.h>
+#include <string.h>
+
+// Prefab library file, one prefab per line, '#' starts a comment:
+//   box    <name> <width> <height> <mass> <is_static 0|1> <texture> <r> <g> <b> <a>
+//   sphere <name> <radius> <mass> <is_static 0|1> <texture> <r> <g> <b> <a>
+// texture is looked up by name in the loaded textures (Assets::find_texture).
+// The size goes into the transform scale, the collider stays the unit shape
+// (box +-0.5, radius 0.5), so the sprite and the collider match.
+
+const u32 PREFAB_NAME_SIZE = 32;
+
+struct Prefab_Library {
+    darr<Physics_Object> objects;
+};
+
+void init(Prefab_Library* lib, u32 cap) {
+    init(&lib->objects, cap);
+}
+
+void shut(Prefab_Library* lib) {
+    shut(&lib->objects);
+}
+
+// the name is interned, spawned bodies keep it through saves and chunk files
+void add_prefab(Prefab_Library* lib, const char* name, Physics_Object prefab) {
+    prefab.name = intern_physics_name(name);
+    dpush(&lib->objects, prefab);
+}
+
+// appends the prefabs in file_name to lib, false if the file can't be read, bad lines are reported and skipped
+bool load_prefabs(Prefab_Library* lib, const char* file_name) {
+    FILE* file = fopen(file_name, "r");
+    if (file == null)
+        return false;
+
+    char line[256];
+    u32 line_number = 0;
+    while (fgets(line, sizeof(line), file) != null) {
+        line_number++;
+        char shape[16];
+        if (sscanf(line, "%15s", shape) != 1 || shape[0] == '#')
+            continue;
+
+        char name[PREFAB_NAME_SIZE];
+        char texture[BUNDLE_NAME_SIZE];
+        f32 mass;
+        i32 is_static;
+        vec4f color;
+        Physics_Object obj = {};
+        obj.transform = { {}, {1, 0, 0, 0}, {1, 1, 1} };
+
+        bool is_valid = false;
+        if (strcmp(shape, "box") == 0) {
+            vec2f size = {};
+            is_valid = sscanf(line, "%*s %31s %f %f %f %d %63s %f %f %f %f", name, &size.x, &size.y,
+                &mass, &is_static, texture, &color.r, &color.g, &color.b, &color.a) == 10;
+            obj.transform.scale = { size.x, size.y, 1 };
+            obj.collider = { .type = Collider_Type::Box_Collider2D,
+            .box_collider2d = {{-0.5f, -0.5f}, {0.5f, 0.5f}}};
+        } else if (strcmp(shape, "sphere") == 0) {
+            f32 radius = 0;
+            is_valid = sscanf(line, "%*s %31s %f %f %d %63s %f %f %f %f", name, &radius,
+                &mass, &is_static, texture, &color.r, &color.g, &color.b, &color.a) == 9;
+            obj.transform.scale = { radius * 2, radius * 2, 1 };
+            obj.collider = { .type = Collider_Type::Sphere_Collider2D,
+            .sphere_collider2d = {{}, 0.5f}};
+        }
+        if (!is_valid) {
+            printf("%s:%u: bad prefab line\n", file_name, line_number);
+            continue;
+        }
+
+        obj.physics_data = { mass, {}, is_static != 0 };
+        obj.material.texture_name = Assets::find_texture(texture);
+        obj.material.color = color;
+        add_prefab(lib, name, obj);
+    }
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,193 @@
+#pragma once
+#include "gpu_graphics/loadings.cc"
+#include "gpu_graphics/draw.cc"
+#include "physics.cc"
+#include "asset_bundle.cc"
+
+// Sprite and collider passes over physics_objects. Kept free of the window and
+// the editor so they can also run offscreen (render_bench.cc).
+
+sbuff<vec3f, 4> quad_vrt_positions = {{
+    { -0.5f, -0.5f, 0 },
+	{ 0.5f, -0.5f, 0 },
+	{ 0.5f, 0.5f, 0 },
+	{ -0.5f, 0.5f, 0 }
+}};
+
+sbuff<u32[3], 10> quad_triangles = {{
+    {0, 1, 2}, //face front
+    {0, 2, 3}
+}};
+
+
+sbuff<vec2f, 4> quad_uvs = {{
+    {0, 0},
+    {1, 0},
+    {1, 1},
+    {0, 1}
+}};
+
+Mesh quad_mesh = {
+    { begin(&quad_vrt_positions), cap(&quad_vrt_positions) },
+    { begin(&quad_triangles), cap(&quad_triangles) }
+};
+
+u32 quad_vao;
+u32 quad_vbo;
+u32 quad_ibo;
+
+u32 box_collider_texture;
+u32 sphere_collider_texture;
+
+// what the passes submitted since the last reset
+struct Render_Stats {
+    u32 draw_calls;
+    u32 shader_binds;
+    u32 vao_binds;
+    u32 texture_binds;
+    u32 uniform_sets;
+};
+
+Render_Stats render_stats = {};
+
+u32 state_changes(Render_Stats* stats) {
+    return stats->shader_binds + stats->vao_binds + stats->texture_binds + stats->uniform_sets;
+}
+
+// sprite shader and textures, from the packed bundle when there is one, returns whether it was
+bool load_render_assets() {
+    // packed bundle is made by pack_assets, fall back to the loose files if it's missing
+    const char* shader_names[] = { "sprite" };
+    bool is_bundle_loaded = Assets::load_bundle("Assets/assets.bundle", shader_names, 1);
+    if (!is_bundle_loaded) {
+        const char* texture_files[] = {
+            "Assets/Textures/SquareTexture.png", "Assets/Textures/CircleTexture.png",
+            "Assets/Textures/BoxCollider2D.png", "Assets/Textures/SphereCollider2D.png"};
+
+        Assets::load_shaders<1>({"Assets/Shaders/sprite.glsl"});
+        Assets::load_textures<4>({texture_files[0], texture_files[1], texture_files[2], texture_files[3]});
+        for (u32 i = 0; i < 4; i++) {
+            Assets::set_texture_name(i, texture_files[i]);
+        }
+        Assets::texture_count = 4;
+    }
+
+    init(&Assets::shaders[0], 3);
+    add_uniform(&Assets::shaders[0], "u_mpv_mat", Type::mat4f);
+    add_uniform(&Assets::shaders[0], "u_texture", Type::i32);
+    add_uniform(&Assets::shaders[0], "u_color", Type::vec4f);
+
+    box_collider_texture = Assets::find_texture("BoxCollider2D");
+    sphere_collider_texture = Assets::find_texture("SphereCollider2D");
+    return is_bundle_loaded;
+}
+
+void init_quad_mesh() {
+    glGenVertexArrays(1, &quad_vao);
+    glBindVertexArray(quad_vao);
+
+    // make buffer for triangle
+    glGenBuffers(1, &quad_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, quad_vbo);
+
+    // allocates vram
+    glBufferData(GL_ARRAY_BUFFER, size(&quad_mesh.vertex_buffer) + sizeof(quad_uvs), null, GL_STATIC_DRAW);
+
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size(&quad_mesh.vertex_buffer), begin(&quad_mesh.vertex_buffer));
+    glBufferSubData(GL_ARRAY_BUFFER, size(&quad_mesh.vertex_buffer), sizeof(quad_uvs), begin(&quad_uvs));
+
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)size(&quad_mesh.vertex_buffer));
+
+    glGenBuffers(1, &quad_ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, size(&quad_mesh.index_buffer), begin(&quad_mesh.index_buffer), GL_STATIC_DRAW);
+}
+
+void render_quads(mat4f vp_m) {
+    bind_shader(Assets::shaders[0].id);
+
+    bind_vao(quad_vao);
+    bind_ibo(quad_ibo);
+    render_stats.shader_binds++;
+    render_stats.vao_binds++;
+
+    // rebound only when the id changes, texture_binds counts real changes
+    u32 bound_texture = 0;
+    for (auto it = begin(&physics_objects); it != end(&physics_objects); it++) {
+        i32 texture_slot = 0;
+        u32 texture = Assets::textures[it->material.texture_name].id;
+        if (texture != bound_texture) {
+            bind_texture(texture, texture_slot);
+            bound_texture = texture;
+            render_stats.texture_binds++;
+        }
+
+        set_uniform(&Assets::shaders[0], 1, texture_slot);
+        vec4f color = it->material.color;
+        set_uniform(&Assets::shaders[0], 2, color);
+
+        mat4f mvp_m = vp_m * model_matrix(&it->transform);
+        set_uniform(&Assets::shaders[0], 0, mvp_m);
+
+        glDrawElements(GL_TRIANGLES, cap(&quad_mesh.index_buffer) * 3, GL_UNSIGNED_INT, null);
+    }
+    render_stats.uniform_sets += len(&physics_objects) * 3;
+    render_stats.draw_calls += len(&physics_objects);
+}
+
+// selection_mask[i] != 0 highlights body i, null highlights nothing
+void render_colliders(mat4f vp_m, darr<u8>* selection_mask) {
+    bind_shader(Assets::shaders[0].id);
+
+    bind_vao(quad_vao);
+    bind_ibo(quad_ibo);
+    render_stats.shader_binds++;
+    render_stats.vao_binds++;
+
+    i32 texture_slot = 1;
+
+    set_uniform(&Assets::shaders[0], 1, texture_slot);
+    render_stats.uniform_sets++;
+
+    u32 mask_len = (selection_mask == null ? 0 : len(selection_mask));
+    u32 bound_texture = 0;
+    for (auto it = begin(&physics_objects); it != end(&physics_objects); it++) {
+        mat4f mvp_m;
+        u32 texture = Assets::textures[it->collider.type == Collider_Type::Box_Collider2D ?
+            box_collider_texture : sphere_collider_texture].id;
+        if (texture != bound_texture) {
+            bind_texture(texture, texture_slot);
+            bound_texture = texture;
+            render_stats.texture_binds++;
+        }
+        if (it->collider.type == Collider_Type::Box_Collider2D) {
+
+            Box_Collider2D& bc = it->collider.box_collider2d;
+            vec2f collider_size = bc.rt - bc.lb;
+            vec2f collider_center = (bc.rt + bc.lb) / 2.0f;
+            Transform t = it->transform;
+            t.position += vec3f(collider_center.x, collider_center.y, 0);
+            t.scale = { t.scale.x * collider_size.x, t.scale.y * collider_size.y, t.scale.z };
+            mvp_m = vp_m * model_matrix(&t);
+        } else if (it->collider.type == Collider_Type::Sphere_Collider2D) {
+            Sphere_Collider2D& c = it->collider.sphere_collider2d;
+            Transform t = it->transform;
+            t.position += vec3f(c.origin.x, c.origin.y, 0);
+            t.scale = { max(t.scale.x, t.scale.y) * 2 * c.radius, max(t.scale.x, t.scale.y)* 2 * c.radius, t.scale.z };
+            mvp_m = vp_m * model_matrix(&t);
+        }
+
+        set_uniform(&Assets::shaders[0], 0, mvp_m);
+        u32 index = it - begin(&physics_objects);
+        bool is_selected = index < mask_len && (*selection_mask)[index];
+        vec4f color = ( is_selected ? vec4f{ 1, 1, 1, 0.8f } : vec4f{ 1, 1, 1, 0.5f } );
+        set_uniform(&Assets::shaders[0], 2, color);
+
+        glDrawElements(GL_TRIANGLES, cap(&quad_mesh.index_buffer) * 3, GL_UNSIGNED_INT, null);
+    }
+    render_stats.uniform_sets += len(&physics_objects) * 2;
+    render_stats.draw_calls += len(&physics_objects);
+}
@@ -0,0 +1,297 @@
+// Offscreen render benchmark.
+//
+// Renders a saved or generated scene for a number of frames into an FBO on a
+// headless EGL context, so render_quads / render_colliders can be timed on
+// machines without a GPU or a display (Mesa's llvmpipe works, e.g. with
+// EGL_PLATFORM=surfaceless). Per pass it reports the CPU submit time, the GPU
+// time from GL_TIME_ELAPSED queries and the draw calls / state changes from
+// render_stats. The last frame can be written to a PNG for visual diffing.
+//
+// usage: render_bench [--scene <save.bin> | --generate <count>] [--frames <k>]
+//                     [--size <w>x<h>] [--no-colliders] [--png <out.png>]
+//
+// Run from the repository root so the assets are found.
+//
+// Build: g++ -O2 render_bench.cc -o render_bench -lEGL -lGL (plus the gl loader gpu_graphics uses)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "scene.cc"
+#include "render.cc"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "gpu_graphics/import/stb_image_write.h"
+
+struct Bench_Options {
+    const char* scene_file = null;
+    u32 generated_count = 10000;
+    u32 frame_count = 100;
+    u32 width = 1280;
+    u32 height = 720;
+    bool are_colliders_rendered = true;
+    const char* png_file = null;
+};
+
+struct Pass_Result {
+    const char* name;
+    f64 cpu_ms;
+    f64 gpu_ms;
+    f64 gpu_min_ms;
+    f64 gpu_max_ms;
+    Render_Stats stats;
+};
+
+struct Headless_Context {
+    EGLDisplay display;
+    EGLSurface surface;
+    EGLContext context;
+};
+
+bool init_headless_context(Headless_Context* hc) {
+    hc->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (hc->display == EGL_NO_DISPLAY || !eglInitialize(hc->display, null, null)) {
+        fprintf(stderr, "no EGL display\n");
+        return false;
+    }
+
+    EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint config_count;
+    if (!eglChooseConfig(hc->display, config_attribs, &config, 1, &config_count) || config_count == 0) {
+        fprintf(stderr, "no EGL config with pbuffer and desktop GL support\n");
+        return false;
+    }
+
+    // rendering goes to an FBO, the pbuffer only makes the context current
+    EGLint surface_attribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+    hc->surface = eglCreatePbufferSurface(hc->display, config, surface_attribs);
+
+    eglBindAPI(EGL_OPENGL_API);
+    EGLint context_attribs[] = {
+        // sprite.glsl and particle.glsl are #version 440 core
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 4,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    hc->context = eglCreateContext(hc->display, config, EGL_NO_CONTEXT, context_attribs);
+    if (hc->context == EGL_NO_CONTEXT || !eglMakeCurrent(hc->display, hc->surface, hc->surface, hc->context)) {
+        fprintf(stderr, "failed to create a GL 4.4 core context, the shaders need #version 440\n");
+        return false;
+    }
+
+#if defined(__GLEW_H__)
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK) {
+        fprintf(stderr, "failed to load GL functions\n");
+        return false;
+    }
+#endif
+    printf("renderer: %s, %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+    return true;
+}
+
+void shut_headless_context(Headless_Context* hc) {
+    eglMakeCurrent(hc->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(hc->display, hc->context);
+    eglDestroySurface(hc->display, hc->surface);
+    eglTerminate(hc->display);
+}
+
+// grid of alternating boxes and spheres, the camera fits the whole grid
+void generate_scene(u32 count, u32 width, u32 height) {
+    init(&physics_objects, max(count, 1u));
+    physics_objects.len = count;
+
+    u32 side = (u32)ceilf(sqrtf((f32)count));
+    f32 spacing = 1.5f;
+    for (u32 i = 0; i < count; i++) {
+        u32 x = i % side;
+        u32 y = i / side;
+        bool is_box = (x + y) % 2 == 0;
+        vec3f position = { (x - side / 2.0f) * spacing, (y - side / 2.0f) * spacing, 0 };
+        vec4f color = { (f32)x / side, (f32)y / side, 0.5f, 1 };
+
+        Physics_Object& obj = physics_objects[i];
+        obj = {};
+        obj.name = (is_box ? "Box" : "Sphere");
+        obj.transform = { position, {1, 0, 0, 0}, {1, 1, 1} };
+        if (is_box) {
+            obj.collider = { .type = Collider_Type::Box_Collider2D,
+            .box_collider2d = {{-0.5f, -0.5f}, {0.5f, 0.5f}}};
+        } else {
+            obj.collider = { .type = Collider_Type::Sphere_Collider2D,
+            .sphere_collider2d = {{}, 0.5f}};
+        }
+        obj.physics_data = { 1, {}, false };
+        obj.material = { 0, is_box ? 0u : 1u, color };
+    }
+
+    f32 ppu = min(width, height) / (side * spacing + spacing);
+    camera.transform.position = {0, 0, 0};
+    camera.pixels_per_unit = {ppu, ppu};
+}
+
+bool parse_options(Bench_Options* opt, int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--scene") == 0 && has_value) {
+            opt->scene_file = argv[++i];
+        } else if (strcmp(argv[i], "--generate") == 0 && has_value) {
+            opt->generated_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--frames") == 0 && has_value) {
+            opt->frame_count = max(atoi(argv[++i]), 1);
+        } else if (strcmp(argv[i], "--size") == 0 && has_value) {
+            if (sscanf(argv[++i], "%ux%u", &opt->width, &opt->height) != 2 || opt->width == 0 || opt->height == 0)
+                return false;
+        } else if (strcmp(argv[i], "--png") == 0 && has_value) {
+            opt->png_file = argv[++i];
+        } else if (strcmp(argv[i], "--no-colliders") == 0) {
+            opt->are_colliders_rendered = false;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool write_png(const char* file_name, u32 width, u32 height) {
+    u8* pixels = m_alloc<u8>(width * height * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    // GL rows go bottom up
+    stbi_flip_vertically_on_write(1);
+    bool is_written = stbi_write_png(file_name, width, height, 4, pixels, width * 4) != 0;
+    m_free(pixels);
+    return is_written;
+}
+
+void print_pass(Pass_Result* r, u32 frame_count) {
+    Render_Stats& s = r->stats;
+    printf("%-10s cpu %8.3f ms  gpu %8.3f ms (min %.3f, max %.3f)  draws %u  state changes %u (shader %u, vao %u, texture %u, uniform %u)\n",
+        r->name, r->cpu_ms / frame_count, r->gpu_ms / frame_count, r->gpu_min_ms, r->gpu_max_ms,
+        s.draw_calls, state_changes(&s), s.shader_binds, s.vao_binds, s.texture_binds, s.uniform_sets);
+}
+
+int main(int argc, char** argv) {
+    Bench_Options opt;
+    if (!parse_options(&opt, argc, argv)) {
+        fprintf(stderr, "usage: %s [--scene <save.bin> | --generate <count>] [--frames <k>] [--size <w>x<h>] [--no-colliders] [--png <out.png>]\n", argv[0]);
+        return 1;
+    }
+
+    Headless_Context hc;
+    if (!init_headless_context(&hc))
+        return 1;
+
+    u32 fbo, color_rb;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glGenRenderbuffers(1, &color_rb);
+    glBindRenderbuffer(GL_RENDERBUFFER, color_rb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, opt.width, opt.height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_rb);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "framebuffer incomplete\n");
+        shut_headless_context(&hc);
+        return 1;
+    }
+    glViewport(0, 0, opt.width, opt.height);
+
+    bool is_bundle_loaded = load_render_assets();
+    init_quad_mesh();
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    if (opt.scene_file != null) {
+        if (!read_scene_file(opt.scene_file)) {
+            fprintf(stderr, "failed to read %s\n", opt.scene_file);
+            shut_headless_context(&hc);
+            return 1;
+        }
+    } else {
+        generate_scene(opt.generated_count, opt.width, opt.height);
+    }
+    printf("%u bodies, %ux%u, %u frames, assets from %s\n", len(&physics_objects), opt.width, opt.height,
+        opt.frame_count, is_bundle_loaded ? "bundle" : "loose files");
+
+    vec2f viewport_size = { (f32)opt.width, (f32)opt.height };
+    mat4f vp_m = proj_xy_orth_matrix(viewport_size, camera.pixels_per_unit, {-1, 30}) * view_matrix(&camera.transform);
+
+    const u32 pass_count = 2;
+    Pass_Result results[pass_count] = { { "quads" }, { "colliders" } };
+    for (u32 p = 0; p < pass_count; p++) {
+        results[p].gpu_min_ms = INFINITY;
+    }
+    u32 queries[pass_count];
+    glGenQueries(pass_count, queries);
+
+    for (u32 frame = 0; frame < opt.frame_count; frame++) {
+        glClearColor(Sandbox_Settings.clear_color.r, Sandbox_Settings.clear_color.g, Sandbox_Settings.clear_color.b, Sandbox_Settings.clear_color.a);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        for (u32 p = 0; p < pass_count; p++) {
+            if (p == 1 && !opt.are_colliders_rendered)
+                continue;
+
+            render_stats = {};
+            glBeginQuery(GL_TIME_ELAPSED, queries[p]);
+            auto start = std::chrono::steady_clock::now();
+            if (p == 0) {
+                render_quads(vp_m);
+            } else {
+                render_colliders(vp_m, null);
+            }
+            results[p].cpu_ms += std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+            glEndQuery(GL_TIME_ELAPSED);
+            results[p].stats = render_stats;
+        }
+
+        // waits for the frame, the queries of this frame are ready after it
+        for (u32 p = 0; p < pass_count; p++) {
+            if (p == 1 && !opt.are_colliders_rendered)
+                continue;
+            GLuint64 ns;
+            glGetQueryObjectui64v(queries[p], GL_QUERY_RESULT, &ns);
+            f64 ms = ns / 1e6;
+            results[p].gpu_ms += ms;
+            results[p].gpu_min_ms = min(results[p].gpu_min_ms, ms);
+            results[p].gpu_max_ms = max(results[p].gpu_max_ms, ms);
+        }
+    }
+
+    printf("per frame averages:\n");
+    for (u32 p = 0; p < pass_count; p++) {
+        if (p == 1 && !opt.are_colliders_rendered)
+            continue;
+        print_pass(&results[p], opt.frame_count);
+    }
+
+    i32 exit_code = 0;
+    if (opt.png_file != null) {
+        if (write_png(opt.png_file, opt.width, opt.height)) {
+            printf("last frame written to %s\n", opt.png_file);
+        } else {
+            fprintf(stderr, "failed to write %s\n", opt.png_file);
+            exit_code = 1;
+        }
+    }
+
+    glDeleteQueries(pass_count, queries);
+    glDeleteRenderbuffers(1, &color_rb);
+    glDeleteFramebuffers(1, &fbo);
+    shut_headless_context(&hc);
+    return exit_code;
+}
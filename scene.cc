@@ -0,0 +1,64 @@
+#pragma once
+#include "physics.cc"
+
+#include <stdio.h>
+#include <string.h>
+
+// Scene save files: Sandbox_Settings, the camera, then the raw physics objects.
+// Shared by the sandbox and the offline tools.
+
+struct {
+    bool is_physics_updated = true;
+    bool are_colliders_rendered = true;
+    vec4f clear_color = {0, 0.2, 0.2, 1};
+} Sandbox_Settings;
+
+struct Camera {
+    Transform transform;
+    vec2f pixels_per_unit;
+};
+
+Camera camera = {
+    {
+    { 0, 0, 0 },
+    { 1, 0, 0, 0},
+    { 0.5, 0.5, 0.5 }
+    },
+    {100, 100}
+};
+
+void write_scene_file(const char* file_name) {
+    FILE* file = fopen(file_name, "wb");
+    if (file == null)
+        return;
+    fwrite(&Sandbox_Settings, sizeof(Sandbox_Settings), 1, file);
+    fwrite(&camera, sizeof(Camera), 1, file);
+    fwrite(&physics_objects.len, sizeof(u32), 1, file);
+    // names go out packed, through a small copy so the live objects keep their pointers
+    Physics_Object packed[256];
+    for (u32 i = 0; i < physics_objects.len; i += 256) {
+        u32 count = min(physics_objects.len - i, 256u);
+        memcpy(packed, begin(&physics_objects) + i, sizeof(Physics_Object) * count);
+        pack_physics_object_names(packed, count);
+        fwrite(packed, sizeof(Physics_Object), count, file);
+    }
+    fclose(file);
+}
+
+// replaces Sandbox_Settings, camera and physics_objects
+bool read_scene_file(const char* file_name) {
+    FILE* file = fopen(file_name, "rb");
+    if (file == null)
+        return false;
+
+    fread(&Sandbox_Settings, sizeof(Sandbox_Settings), 1, file);
+    fread(&camera, sizeof(Camera), 1, file);
+    u32 len;
+    fread(&len, sizeof(u32), 1, file);
+    init(&physics_objects, len);
+    physics_objects.len = len;
+    fread(physics_objects.buffer, sizeof(Physics_Object), len, file);
+    fclose(file);
+    unpack_physics_object_names(begin(&physics_objects), len);
+    return true;
+}
@@ -0,0 +1,342 @@
+#pragma once
+#include "physics.cc"
+#include "jobs.cc"
+#include "asset_bundle.cc"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+// Bulk scene import from CSV or JSON lines, one body per line.
+//
+// CSV columns, trailing ones may be left out:
+//   type,x,y,angle,scale_x,scale_y,w,h,mass,vx,vy,static,texture,r,g,b,a
+// JSON lines use the same names as keys ("radius" is the same as "w"):
+//   {"type": "sphere", "x": 1.5, "y": -2, "radius": 0.5, "static": false}
+// type is box or sphere, a sphere's radius is w. angle is in radians, texture
+// is an index into Assets::textures. Lines starting with '#' and a CSV header
+// (first field "type") are skipped.
+//
+// The file is read in fixed size chunks. Each chunk is split into lines, the
+// bodies are reserved in physics_objects once and the lines are parsed in
+// parallel straight into their slots, so memory overhead doesn't grow with
+// the file.
+
+const u32 IMPORT_CHUNK_SIZE = 8 << 20;
+
+struct Body_Record {
+    Collider_Type type;
+    // in the column order of the CSV format, after type
+    f32 x, y, angle;
+    f32 scale_x, scale_y;
+    f32 w, h;
+    f32 mass;
+    f32 vx, vy;
+    f32 is_static;
+    f32 texture;
+    f32 r, g, b, a;
+};
+const u32 body_record_field_count = 16;
+const char* body_record_field_names[body_record_field_count] = {
+    "x", "y", "angle", "scale_x", "scale_y", "w", "h", "mass", "vx", "vy", "static", "texture", "r", "g", "b", "a"
+};
+
+enum Import_Row : u8 {
+    Import_Ok,
+    Import_Skipped,
+    Import_Error,
+};
+
+struct Import_Report {
+    u32 body_count;
+    u32 error_count;
+    // first bad line, 0 if none
+    u64 first_error_line;
+    f32 ms;
+};
+
+struct {
+    u32 thread_count = 0;
+
+    char* buffer;
+    darr<u32> line_starts;
+    darr<u8> rows;
+} Scene_Import;
+
+inline f32* record_field(Body_Record* r, u32 index) {
+    return &r->x + index;
+}
+
+void default_record(Body_Record* r) {
+    *r = {};
+    r->type = Collider_Type::Box_Collider2D;
+    r->scale_x = r->scale_y = 1;
+    r->w = r->h = 1;
+    r->mass = 1;
+    r->r = r->g = r->b = r->a = 1;
+}
+
+inline const char* skip_spaces(const char* it, const char* end) {
+    while (it < end && (*it == ' ' || *it == '\t' || *it == '\r'))
+        it++;
+    return it;
+}
+
+// strtof skips newlines on its own, so it's only called on something that starts like a number
+inline bool parse_number(const char** it, const char* end, f32* out) {
+    const char* p = skip_spaces(*it, end);
+    if (p == end || !((*p >= '0' && *p <= '9') || *p == '-' || *p == '+' || *p == '.'))
+        return false;
+    char* num_end;
+    f32 v = strtof(p, &num_end);
+    if (num_end == p || num_end > end)
+        return false;
+    *out = v;
+    *it = num_end;
+    return true;
+}
+
+inline bool is_token(const char* it, const char* end, const char* token) {
+    u32 len = strlen(token);
+    return (u32)(end - it) == len && strncmp(it, token, len) == 0;
+}
+
+// 0 not a type, 1 box, 2 sphere, 3 the CSV header
+u32 parse_type(const char* it, const char* end) {
+    if (is_token(it, end, "box") || is_token(it, end, "Box"))
+        return 1;
+    if (is_token(it, end, "sphere") || is_token(it, end, "Sphere"))
+        return 2;
+    if (is_token(it, end, "type"))
+        return 3;
+    return 0;
+}
+
+Import_Row parse_csv_line(const char* it, const char* end, Body_Record* r) {
+    const char* field_end = (const char*)memchr(it, ',', end - it);
+    if (field_end == null)
+        field_end = end;
+    const char* type_end = field_end;
+    it = skip_spaces(it, end);
+    while (type_end > it && (type_end[-1] == ' ' || type_end[-1] == '\r'))
+        type_end--;
+
+    u32 type = parse_type(it, type_end);
+    if (type == 3)
+        return Import_Skipped;
+    if (type == 0)
+        return Import_Error;
+    r->type = (type == 1 ? Collider_Type::Box_Collider2D : Collider_Type::Sphere_Collider2D);
+
+    it = field_end;
+    for (u32 i = 0; i < body_record_field_count && it < end; i++) {
+        it++; // ','
+        // empty fields keep their default
+        const char* p = skip_spaces(it, end);
+        if (p == end || *p == ',') {
+            it = p;
+            continue;
+        }
+        if (!parse_number(&it, end, record_field(r, i)))
+            return Import_Error;
+        it = skip_spaces(it, end);
+        if (it < end && *it != ',')
+            return Import_Error;
+    }
+    return Import_Ok;
+}
+
+Import_Row parse_json_line(const char* it, const char* end, Body_Record* r) {
+    bool has_type = false;
+    it++; // '{'
+    for (;;) {
+        it = skip_spaces(it, end);
+        if (it < end && *it == ',')
+            it = skip_spaces(it + 1, end);
+        if (it == end || *it == '}')
+            break;
+        if (*it != '"')
+            return Import_Error;
+
+        const char* key = it + 1;
+        const char* key_end = (const char*)memchr(key, '"', end - key);
+        if (key_end == null)
+            return Import_Error;
+        it = skip_spaces(key_end + 1, end);
+        if (it == end || *it != ':')
+            return Import_Error;
+        it = skip_spaces(it + 1, end);
+        if (it == end)
+            return Import_Error;
+
+        if (is_token(key, key_end, "type")) {
+            if (*it != '"')
+                return Import_Error;
+            const char* value = it + 1;
+            const char* value_end = (const char*)memchr(value, '"', end - value);
+            if (value_end == null)
+                return Import_Error;
+            u32 type = parse_type(value, value_end);
+            if (type != 1 && type != 2)
+                return Import_Error;
+            r->type = (type == 1 ? Collider_Type::Box_Collider2D : Collider_Type::Sphere_Collider2D);
+            has_type = true;
+            it = value_end + 1;
+            continue;
+        }
+
+        f32* field = null;
+        if (is_token(key, key_end, "radius")) {
+            field = &r->w;
+        }
+        for (u32 i = 0; i < body_record_field_count && field == null; i++) {
+            if (is_token(key, key_end, body_record_field_names[i]))
+                field = record_field(r, i);
+        }
+        if (field == null)
+            return Import_Error;
+
+        if (end - it >= 4 && strncmp(it, "true", 4) == 0) {
+            *field = 1;
+            it += 4;
+        } else if (end - it >= 5 && strncmp(it, "false", 5) == 0) {
+            *field = 0;
+            it += 5;
+        } else if (!parse_number(&it, end, field)) {
+            return Import_Error;
+        }
+    }
+    return (has_type ? Import_Ok : Import_Error);
+}
+
+void record_to_object(Body_Record* r, Physics_Object* obj) {
+    *obj = {};
+    bool is_box = r->type == Collider_Type::Box_Collider2D;
+    obj->name = collider_type_name(r->type);
+    obj->transform = { {r->x, r->y, 0}, {cosf(r->angle / 2), 0, 0, sinf(r->angle / 2)}, {r->scale_x, r->scale_y, 1} };
+    if (is_box) {
+        obj->collider = { .type = Collider_Type::Box_Collider2D,
+        .box_collider2d = {{-r->w / 2, -r->h / 2}, {r->w / 2, r->h / 2}}};
+    } else {
+        obj->collider = { .type = Collider_Type::Sphere_Collider2D,
+        .sphere_collider2d = {{}, r->w}};
+    }
+    obj->physics_data = { r->mass, {r->vx, r->vy}, r->is_static != 0 };
+    u32 texture_count = max(Assets::texture_count, 1u);
+    obj->material.texture_name = min((u32)max(r->texture, 0.0f), texture_count - 1);
+    obj->material.color = { r->r, r->g, r->b, r->a };
+}
+
+Import_Row parse_line(const char* it, const char* end, Physics_Object* out) {
+    it = skip_spaces(it, end);
+    if (it == end || *it == '#')
+        return Import_Skipped;
+
+    Body_Record r;
+    default_record(&r);
+    Import_Row row = (*it == '{' ? parse_json_line(it, end, &r) : parse_csv_line(it, end, &r));
+    if (row == Import_Ok) {
+        record_to_object(&r, out);
+    }
+    return row;
+}
+
+// parses the whole lines in data[0, size) into new bodies, drops the rows that didn't make one
+void import_chunk(const char* data, u32 size, u64 first_line, Import_Report* report) {
+    Scene_Import.line_starts.len = 0;
+    for (u32 at = 0; at < size;) {
+        dpush(&Scene_Import.line_starts, at);
+        const char* nl = (const char*)memchr(data + at, '\n', size - at);
+        at = (nl == null ? size : (u32)(nl - data) + 1);
+    }
+    u32 line_count = len(&Scene_Import.line_starts);
+    // one past the last line, so line i ends where line i + 1 starts
+    dpush(&Scene_Import.line_starts, size);
+    fit_len(&Scene_Import.rows, line_count);
+
+    u32 first = len(&physics_objects);
+    Physics_Object* out = push_physics_objects(line_count);
+    u32* starts = begin(&Scene_Import.line_starts);
+    u8* rows = begin(&Scene_Import.rows);
+    Jobs::parallel_for(line_count, Scene_Import.thread_count, [=](u32 b, u32 e) {
+        for (u32 i = b; i < e; i++) {
+            const char* line_end = data + starts[i + 1];
+            if (line_end > data + starts[i] && line_end[-1] == '\n')
+                line_end--;
+            rows[i] = parse_line(data + starts[i], line_end, &out[i]);
+        }
+    });
+
+    // compact over the skipped and bad rows, in file order
+    u32 kept = 0;
+    for (u32 i = 0; i < line_count; i++) {
+        if (rows[i] == Import_Ok) {
+            if (kept != i)
+                out[kept] = out[i];
+            kept++;
+            continue;
+        }
+        if (rows[i] == Import_Error) {
+            if (report->error_count == 0)
+                report->first_error_line = first_line + i + 1;
+            report->error_count++;
+        }
+    }
+    physics_objects.len = first + kept;
+    report->body_count += kept;
+}
+
+// appends the bodies in file to physics_objects, file_name is only used in messages.
+// pushing a chunk may move physics_objects and notify remap listeners, so
+// anything still indexing a replaced scene has to be reset before this
+Import_Report import_scene(FILE* file, const char* file_name) {
+    Import_Report report = {};
+    auto start = std::chrono::steady_clock::now();
+
+    if (Scene_Import.buffer == null) {
+        Scene_Import.buffer = m_alloc<char>(IMPORT_CHUNK_SIZE + 1);
+        init(&Scene_Import.line_starts, 1 << 16);
+        init(&Scene_Import.rows, 1 << 16);
+    }
+    if (Scene_Import.thread_count == 0) {
+        Scene_Import.thread_count = Jobs::max_thread_count();
+    }
+
+    char* buffer = Scene_Import.buffer;
+    u32 carry = 0;
+    u64 line_number = 0;
+    for (;;) {
+        u32 read = fread(buffer + carry, 1, IMPORT_CHUNK_SIZE - carry, file);
+        u32 size = carry + read;
+        if (size == 0)
+            break;
+        // strtof may look one past a line, keep it off stale bytes
+        buffer[size] = 0;
+
+        bool is_eof = (read == 0);
+        u32 whole = size;
+        if (!is_eof) {
+            const char* last_nl = (const char*)memrchr(buffer, '\n', size);
+            // a line longer than a chunk is cut where the chunk ends
+            whole = (last_nl == null ? size : (u32)(last_nl - buffer) + 1);
+        }
+
+        import_chunk(buffer, whole, line_number, &report);
+        line_number += len(&Scene_Import.line_starts) - 1;
+
+        carry = size - whole;
+        memmove(buffer, buffer + whole, carry);
+        if (is_eof)
+            break;
+    }
+
+    report.ms = std::chrono::duration<f32, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("imported %u bodies from %s in %.1f ms", report.body_count, file_name, report.ms);
+    if (report.error_count > 0) {
+        printf(", %u bad lines (first at line %llu)", report.error_count, (unsigned long long)report.first_error_line);
+    }
+    printf("\n");
+    return report;
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include "cp_lib/basic.cc"
+
+#include <stdio.h>
+#include <math.h>
+
+// Bounds the time spent on fixed steps per frame. The accumulator is drained at
+// most as far as the measured step cost allows, the rest of the time is
+// dropped. Under sustained overload the step rate is lowered and then the sim
+// is slowed down, with headroom the levels are restored in reverse order.
+
+// each level is (step rate divisor, time scale)
+struct Step_Budget_Level {
+    u32 rate_divisor;
+    f32 time_scale;
+};
+
+const Step_Budget_Level step_budget_levels[] = {
+    { 1, 1.0f },
+    { 2, 1.0f },
+    { 3, 1.0f },
+    { 3, 0.5f },
+    { 3, 0.25f },
+};
+const u32 step_budget_level_count = sizeof(step_budget_levels) / sizeof(step_budget_levels[0]);
+
+struct {
+    bool is_enabled = true;
+    f32 budget_ms = 8;
+    // hard cap, also covers the first frames before a cost is measured
+    u32 max_steps_per_frame = 32;
+    // consecutive frames before a level change
+    u32 degrade_frames = 10;
+    u32 recover_frames = 120;
+    // a finer level is taken back only if its projected cost stays under this share of the budget
+    f32 recover_share = 0.6f;
+
+    f32 base_dt = 1.0f / 360;
+    f32 accumulator = 0;
+    u32 level = 0;
+
+    // running average cost of one step
+    f32 step_ms = 0;
+    u32 overloaded_streak = 0;
+    u32 headroom_streak = 0;
+
+    // last frame
+    u32 steps_wanted = 0;
+    u32 steps_run = 0;
+    f32 frame_ms = 0;
+    f32 dropped_ms = 0;
+
+    f32 total_dropped_s = 0;
+    u32 level_changes = 0;
+} Step_Budget;
+
+f32 step_budget_dt() {
+    return Step_Budget.base_dt * step_budget_levels[Step_Budget.level].rate_divisor;
+}
+
+f32 step_budget_time_scale() {
+    return step_budget_levels[Step_Budget.level].time_scale;
+}
+
+void init_step_budget(f32 base_dt) {
+    Step_Budget.base_dt = base_dt;
+    Step_Budget.accumulator = 0;
+    Step_Budget.level = 0;
+    Step_Budget.step_ms = 0;
+    Step_Budget.overloaded_streak = 0;
+    Step_Budget.headroom_streak = 0;
+    Step_Budget.total_dropped_s = 0;
+    Step_Budget.level_changes = 0;
+}
+
+void set_step_budget_level(u32 level, const char* reason) {
+    // the accumulator is in scaled sim time, it carries over as is
+    Step_Budget.level = level;
+    Step_Budget.level_changes++;
+    Step_Budget.overloaded_streak = 0;
+    Step_Budget.headroom_streak = 0;
+    printf("step budget: %s (%.3f ms/step, %u/%u steps, %.2f ms of %.2f ms), now %.0f Hz at %.2fx\n",
+        reason, Step_Budget.step_ms, Step_Budget.steps_run, Step_Budget.steps_wanted,
+        Step_Budget.frame_ms, Step_Budget.budget_ms, 1 / step_budget_dt(), step_budget_time_scale());
+}
+
+// adds a frame of real time, returns how many steps of step_budget_dt() to run now
+u32 plan_physics_steps(f32 frame_dt) {
+    Step_Budget.accumulator += frame_dt * step_budget_time_scale();
+    f32 dt = step_budget_dt();
+    // clamped as f64, (f32)UINT32_MAX rounds up to 2^32 which doesn't fit a u32
+    u32 wanted = (u32)min(floor((f64)Step_Budget.accumulator / dt), (f64)UINT32_MAX);
+    Step_Budget.steps_wanted = wanted;
+
+    if (!Step_Budget.is_enabled) {
+        Step_Budget.accumulator -= wanted * dt;
+        Step_Budget.dropped_ms = 0;
+        return wanted;
+    }
+
+    u32 allowed = Step_Budget.max_steps_per_frame;
+    if (Step_Budget.step_ms > 0) {
+        allowed = min(allowed, (u32)(Step_Budget.budget_ms / Step_Budget.step_ms));
+    }
+    // always make some progress, one step over budget beats a frozen sim
+    allowed = max(allowed, 1u);
+
+    u32 count = min(wanted, allowed);
+    Step_Budget.accumulator -= count * dt;
+    Step_Budget.dropped_ms = 0;
+    if (wanted > count) {
+        // only whole steps are dropped, the leftover fraction carries into the next frame
+        f32 dropped = (wanted - count) * dt;
+        Step_Budget.accumulator -= dropped;
+        Step_Budget.dropped_ms = dropped * 1000;
+        Step_Budget.total_dropped_s += dropped;
+    }
+    return count;
+}
+
+// reports what running the planned steps cost and moves between levels
+void finish_physics_steps(u32 step_count, f32 ms) {
+    Step_Budget.steps_run = step_count;
+    Step_Budget.frame_ms = ms;
+    if (step_count > 0) {
+        f32 ms_per_step = ms / step_count;
+        Step_Budget.step_ms = (Step_Budget.step_ms == 0 ? ms_per_step : Step_Budget.step_ms * 0.8f + ms_per_step * 0.2f);
+    }
+    if (!Step_Budget.is_enabled) {
+        if (Step_Budget.level != 0) {
+            set_step_budget_level(0, "disabled");
+        }
+        return;
+    }
+
+    // by cost only, steps cut by max_steps_per_frame at a low frame rate may still be cheap.
+    // the wanted steps are projected too, steps cut to fit the budget keep ms just under it
+    f32 wanted_ms = Step_Budget.steps_wanted * Step_Budget.step_ms;
+    bool is_overloaded = max(ms, wanted_ms) > Step_Budget.budget_ms;
+    if (is_overloaded) {
+        Step_Budget.headroom_streak = 0;
+        if (++Step_Budget.overloaded_streak >= Step_Budget.degrade_frames && Step_Budget.level + 1 < step_budget_level_count) {
+            set_step_budget_level(Step_Budget.level + 1, "overloaded");
+        }
+        return;
+    }
+
+    Step_Budget.overloaded_streak = 0;
+    if (Step_Budget.level == 0 || step_count == 0)
+        return;
+
+    // the same sim time at the finer level costs proportionally more steps
+    const Step_Budget_Level& cur = step_budget_levels[Step_Budget.level];
+    const Step_Budget_Level& finer = step_budget_levels[Step_Budget.level - 1];
+    f32 projected_ms = ms * ((f32)cur.rate_divisor / finer.rate_divisor) * (finer.time_scale / cur.time_scale);
+    if (projected_ms > Step_Budget.budget_ms * Step_Budget.recover_share) {
+        Step_Budget.headroom_streak = 0;
+        return;
+    }
+    if (++Step_Budget.headroom_streak >= Step_Budget.recover_frames) {
+        set_step_budget_level(Step_Budget.level - 1, "headroom");
+    }
+}
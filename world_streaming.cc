@@ -0,0 +1,419 @@
+#pragma once
+#include "physics.cc"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// World streaming. The world is cut into square chunks stored on disk as raw
+// Physics_Object arrays. Chunks around the camera are kept in physics_objects
+// and far ones are written back out. Chunk membership is only decided at
+// eviction time, by body position, so bodies that crossed a chunk border
+// simply leave with the chunk they ended up in. All file I/O happens on a
+// background thread; the main thread only moves bodies in and out of
+// physics_objects, and load integration is budgeted per frame.
+
+struct Chunk_Coord {
+    i32 x;
+    i32 y;
+};
+
+inline bool operator==(Chunk_Coord c1, Chunk_Coord c2) {
+    return c1.x == c2.x && c1.y == c2.y;
+}
+
+enum struct Chunk_State {
+    Pending, Loaded
+};
+
+struct Chunk {
+    Chunk_Coord coord;
+    Chunk_State state;
+};
+
+enum struct Chunk_Job_Type {
+    // read the chunk file into objects
+    Load,
+    // replace the chunk file with objects
+    Save,
+    // add objects to the chunk file, for bodies that moved into a chunk that isn't in memory
+    Append
+};
+
+struct Chunk_Job {
+    Chunk_Job_Type type;
+    Chunk_Coord coord;
+    darr<Physics_Object> objects;
+    // bodies of a finished load already moved to physics_objects
+    u32 integrated;
+    // loads from before a reset are dropped
+    u32 generation;
+};
+
+const u32 chunk_lookup_size = 4096;
+
+struct {
+    bool is_enabled = false;
+    f32 chunk_size = 32;
+    // loaded area reaches this far past the view, eviction happens one chunk further
+    f32 margin = 16;
+    u32 integration_budget = 4000;
+    char directory[100] = "Saves/World";
+
+    darr<Chunk> chunks;
+    // open addressing table of chunk index + 1, rebuilt whenever chunks changes
+    u32 lookup[chunk_lookup_size];
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable queue_cv;
+    std::condition_variable idle_cv;
+    bool is_worker_running = false;
+    bool is_quitting = false;
+    // guarded by mutex
+    darr<Chunk_Job> queue;
+    darr<Chunk_Job> completed;
+    u32 jobs_in_flight = 0;
+    u32 generation = 0;
+
+    // main thread scratch
+    darr<Chunk_Job> outgoing;
+    darr<u32> evicted_indices;
+    darr<Chunk_Coord> evicting;
+} World_Streaming;
+
+inline u32 chunk_hash(Chunk_Coord c) {
+    return ((u32)c.x * 73856093u ^ (u32)c.y * 19349663u) & (chunk_lookup_size - 1);
+}
+
+Chunk_Coord chunk_of(vec2f p) {
+    return { (i32)floorf(p.x / World_Streaming.chunk_size), (i32)floorf(p.y / World_Streaming.chunk_size) };
+}
+
+void rebuild_chunk_lookup() {
+    memset(World_Streaming.lookup, 0, sizeof(World_Streaming.lookup));
+    for (u32 i = 0; i < len(&World_Streaming.chunks); i++) {
+        u32 h = chunk_hash(World_Streaming.chunks[i].coord);
+        while (World_Streaming.lookup[h] != 0) {
+            h = (h + 1) & (chunk_lookup_size - 1);
+        }
+        World_Streaming.lookup[h] = i + 1;
+    }
+}
+
+Chunk* find_chunk(Chunk_Coord c) {
+    u32 h = chunk_hash(c);
+    while (World_Streaming.lookup[h] != 0) {
+        Chunk* chunk = &World_Streaming.chunks[World_Streaming.lookup[h] - 1];
+        if (chunk->coord == c)
+            return chunk;
+        h = (h + 1) & (chunk_lookup_size - 1);
+    }
+    return null;
+}
+
+void chunk_file_name(char* out, Chunk_Coord c) {
+    sprintf(out, "%s/chunk_%d_%d.bin", World_Streaming.directory, c.x, c.y);
+}
+
+// files hold no header, body count is file size / sizeof(Physics_Object), so appending is a plain write
+void run_chunk_job(Chunk_Job* job) {
+    char file_name[160];
+    chunk_file_name(file_name, job->coord);
+
+    switch (job->type) {
+        case Chunk_Job_Type::Load:
+        {
+            init(&job->objects, 16);
+            FILE* file = fopen(file_name, "rb");
+            if (file == null)
+                break;
+            fseek(file, 0, SEEK_END);
+            u32 count = ftell(file) / sizeof(Physics_Object);
+            fseek(file, 0, SEEK_SET);
+            fit_len(&job->objects, count);
+            job->objects.len = fread(job->objects.buffer, sizeof(Physics_Object), count, file);
+            fclose(file);
+            // names stay packed until the main thread integrates the bodies
+        } break;
+        case Chunk_Job_Type::Save:
+        case Chunk_Job_Type::Append:
+        {
+            FILE* file = fopen(file_name, job->type == Chunk_Job_Type::Save ? "wb" : "ab");
+            // the job holds copies, names are only read
+            pack_physics_object_names(begin(&job->objects), len(&job->objects));
+            if (file != null) {
+                fwrite(job->objects.buffer, sizeof(Physics_Object), job->objects.len, file);
+                fclose(file);
+            } else {
+                printf("world streaming: failed to write %s, %u bodies lost\n", file_name, job->objects.len);
+            }
+            shut(&job->objects);
+        } break;
+    }
+}
+
+void world_streaming_worker() {
+    for (;;) {
+        Chunk_Job job;
+        {
+            std::unique_lock<std::mutex> lock(World_Streaming.mutex);
+            World_Streaming.queue_cv.wait(lock, [] { return World_Streaming.is_quitting || len(&World_Streaming.queue) > 0; });
+            if (len(&World_Streaming.queue) == 0)
+                return;
+            // FIFO, so a save of a chunk always lands before a later load of it
+            job = World_Streaming.queue[0];
+            memmove(&World_Streaming.queue[0], &World_Streaming.queue[1], sizeof(Chunk_Job) * (len(&World_Streaming.queue) - 1));
+            World_Streaming.queue.len--;
+        }
+
+        run_chunk_job(&job);
+
+        std::lock_guard<std::mutex> lock(World_Streaming.mutex);
+        if (job.type == Chunk_Job_Type::Load) {
+            dpush(&World_Streaming.completed, job);
+        }
+        World_Streaming.jobs_in_flight--;
+        if (World_Streaming.jobs_in_flight == 0) {
+            World_Streaming.idle_cv.notify_all();
+        }
+    }
+}
+
+void push_chunk_job(Chunk_Job job) {
+    {
+        std::lock_guard<std::mutex> lock(World_Streaming.mutex);
+        job.generation = World_Streaming.generation;
+        dpush(&World_Streaming.queue, job);
+        World_Streaming.jobs_in_flight++;
+    }
+    World_Streaming.queue_cv.notify_one();
+}
+
+void init_world_streaming() {
+    init(&World_Streaming.chunks, 64);
+    init(&World_Streaming.queue, 64);
+    init(&World_Streaming.completed, 64);
+    init(&World_Streaming.outgoing, 16);
+    init(&World_Streaming.evicted_indices, 256);
+    init(&World_Streaming.evicting, 16);
+    rebuild_chunk_lookup();
+
+    World_Streaming.is_quitting = false;
+    World_Streaming.worker = std::thread(world_streaming_worker);
+    World_Streaming.is_worker_running = true;
+}
+
+// finishes queued jobs before returning, bodies still in memory are not written, see flush_world_streaming
+void shut_world_streaming() {
+    if (!World_Streaming.is_worker_running)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(World_Streaming.mutex);
+        World_Streaming.is_quitting = true;
+    }
+    World_Streaming.queue_cv.notify_one();
+    World_Streaming.worker.join();
+    World_Streaming.is_worker_running = false;
+}
+
+u32 world_streaming_queue_len() {
+    std::lock_guard<std::mutex> lock(World_Streaming.mutex);
+    return len(&World_Streaming.queue);
+}
+
+// forget chunk bookkeeping, bodies already in memory stay there
+void reset_world_streaming() {
+    std::lock_guard<std::mutex> lock(World_Streaming.mutex);
+    World_Streaming.generation++;
+    for (auto it = begin(&World_Streaming.completed); it != end(&World_Streaming.completed); it++) {
+        shut(&it->objects);
+    }
+    World_Streaming.completed.len = 0;
+    World_Streaming.chunks.len = 0;
+    rebuild_chunk_lookup();
+}
+
+Chunk_Job* find_outgoing(Chunk_Coord c, Chunk_Job_Type type) {
+    for (auto it = begin(&World_Streaming.outgoing); it != end(&World_Streaming.outgoing); it++) {
+        if (it->coord == c)
+            return it;
+    }
+    Chunk_Job job = {};
+    job.type = type;
+    job.coord = c;
+    init(&job.objects, 64);
+    dpush(&World_Streaming.outgoing, job);
+    return &World_Streaming.outgoing[len(&World_Streaming.outgoing) - 1];
+}
+
+bool is_evicting(Chunk_Coord c) {
+    for (auto it = begin(&World_Streaming.evicting); it != end(&World_Streaming.evicting); it++) {
+        if (*it == c)
+            return true;
+    }
+    return false;
+}
+
+// moves bodies of evicted chunks, and strays in chunks that aren't in memory, out to disk
+void evict_bodies(bool is_everything) {
+    World_Streaming.outgoing.len = 0;
+    World_Streaming.evicted_indices.len = 0;
+
+    for (auto it = begin(&World_Streaming.evicting); it != end(&World_Streaming.evicting); it++) {
+        find_outgoing(*it, Chunk_Job_Type::Save);
+    }
+
+    for (u32 i = 0; i < len(&physics_objects); i++) {
+        Chunk_Coord c = chunk_of((vec2f)physics_objects[i].transform.position);
+        Chunk* chunk = find_chunk(c);
+        Chunk_Job_Type type;
+        // only a loaded chunk has all of its bodies in memory, anything else gets appended to
+        if (is_evicting(c) || (is_everything && chunk != null && chunk->state == Chunk_State::Loaded)) {
+            type = Chunk_Job_Type::Save;
+        } else if (chunk == null || is_everything) {
+            type = Chunk_Job_Type::Append;
+        } else {
+            continue;
+        }
+        dpush(&find_outgoing(c, type)->objects, physics_objects[i]);
+        dpush(&World_Streaming.evicted_indices, i);
+    }
+
+    for (auto it = begin(&World_Streaming.outgoing); it != end(&World_Streaming.outgoing); it++) {
+        push_chunk_job(*it);
+    }
+    World_Streaming.outgoing.len = 0;
+
+    if (len(&World_Streaming.evicted_indices) > 0) {
+        remove_physics_objects(begin(&World_Streaming.evicted_indices), len(&World_Streaming.evicted_indices));
+    }
+}
+
+void integrate_loaded_chunks(u32 budget) {
+    std::lock_guard<std::mutex> lock(World_Streaming.mutex);
+    while (len(&World_Streaming.completed) > 0 && budget > 0) {
+        Chunk_Job& job = World_Streaming.completed[0];
+        if (job.generation == World_Streaming.generation) {
+            u32 count = min(len(&job.objects) - job.integrated, budget);
+            if (count > 0) {
+                unpack_physics_object_names(begin(&job.objects) + job.integrated, count);
+                append_physics_objects(begin(&job.objects) + job.integrated, count);
+            }
+            job.integrated += count;
+            budget -= count;
+            if (job.integrated < len(&job.objects))
+                break;
+
+            Chunk* chunk = find_chunk(job.coord);
+            if (chunk != null) {
+                chunk->state = Chunk_State::Loaded;
+            }
+        }
+        shut(&job.objects);
+        memmove(&World_Streaming.completed[0], &World_Streaming.completed[1], sizeof(Chunk_Job) * (len(&World_Streaming.completed) - 1));
+        World_Streaming.completed.len--;
+    }
+}
+
+// writes everything in memory back to chunk files, empties physics_objects and
+// turns streaming off, or the next update would load it all back
+void flush_world_streaming() {
+    {
+        std::unique_lock<std::mutex> lock(World_Streaming.mutex);
+        World_Streaming.idle_cv.wait(lock, [] { return World_Streaming.jobs_in_flight == 0; });
+    }
+    integrate_loaded_chunks(UINT32_MAX);
+
+    // every loaded chunk is rewritten, also the ones whose bodies all moved elsewhere,
+    // their old file would bring the bodies back as duplicates
+    World_Streaming.evicting.len = 0;
+    for (auto it = begin(&World_Streaming.chunks); it != end(&World_Streaming.chunks); it++) {
+        if (it->state == Chunk_State::Loaded) {
+            dpush(&World_Streaming.evicting, it->coord);
+        }
+    }
+    evict_bodies(true);
+    World_Streaming.evicting.len = 0;
+    World_Streaming.chunks.len = 0;
+    rebuild_chunk_lookup();
+    World_Streaming.is_enabled = false;
+}
+
+// writes every body in memory to chunk files, replacing whatever chunk files were
+// there, and empties physics_objects, streaming brings the bodies back
+void bake_world_chunks() {
+    DIR* dir = opendir(World_Streaming.directory);
+    if (dir == null) {
+        mkdir(World_Streaming.directory, 0755);
+    } else {
+        while (dirent* entry = readdir(dir)) {
+            if (strncmp(entry->d_name, "chunk_", 6) == 0) {
+                char file_name[400];
+                sprintf(file_name, "%s/%s", World_Streaming.directory, entry->d_name);
+                remove(file_name);
+            }
+        }
+        closedir(dir);
+    }
+
+    reset_world_streaming();
+    World_Streaming.evicting.len = 0;
+    evict_bodies(true);
+}
+
+void update_world_streaming(vec2f center, vec2f view_half_size) {
+    if (!World_Streaming.is_enabled)
+        return;
+
+    f32 size = World_Streaming.chunk_size;
+    vec2f reach = view_half_size + vec2f(World_Streaming.margin, World_Streaming.margin);
+    Chunk_Coord load_min = chunk_of(center - reach);
+    Chunk_Coord load_max = chunk_of(center + reach);
+    Chunk_Coord keep_min = chunk_of(center - reach - vec2f(size, size));
+    Chunk_Coord keep_max = chunk_of(center + reach + vec2f(size, size));
+
+    integrate_loaded_chunks(World_Streaming.integration_budget);
+
+    // request chunks entering the load area, the lookup table bounds how many can be around
+    bool is_changed = false;
+    for (i32 y = load_min.y; y <= load_max.y; y++) {
+        for (i32 x = load_min.x; x <= load_max.x; x++) {
+            Chunk_Coord c = { x, y };
+            if (find_chunk(c) != null || len(&World_Streaming.chunks) >= chunk_lookup_size / 2)
+                continue;
+            dpush(&World_Streaming.chunks, { c, Chunk_State::Pending });
+            Chunk_Job job = {};
+            job.type = Chunk_Job_Type::Load;
+            job.coord = c;
+            push_chunk_job(job);
+            is_changed = true;
+        }
+    }
+
+    // evict loaded chunks that left the keep area, pending ones wait until they are in
+    World_Streaming.evicting.len = 0;
+    u32 new_len = 0;
+    for (u32 i = 0; i < len(&World_Streaming.chunks); i++) {
+        Chunk chunk = World_Streaming.chunks[i];
+        bool is_kept = chunk.coord.x >= keep_min.x && chunk.coord.x <= keep_max.x &&
+            chunk.coord.y >= keep_min.y && chunk.coord.y <= keep_max.y;
+        if (is_kept || chunk.state == Chunk_State::Pending) {
+            World_Streaming.chunks[new_len++] = chunk;
+        } else {
+            dpush(&World_Streaming.evicting, chunk.coord);
+            is_changed = true;
+        }
+    }
+    World_Streaming.chunks.len = new_len;
+
+    if (is_changed) {
+        rebuild_chunk_lookup();
+    }
+    evict_bodies(false);
+}